@@ -0,0 +1,37 @@
+#
+# Generates a header with the source of every shader in SHADER_DIR as a byte array.
+# Run in script mode: cmake -DSHADER_DIR=<dir> -DOUTPUT=<header> -P embedShaders.cmake
+#
+file (GLOB SHADER_FILES ${SHADER_DIR}/*.comp
+                        ${SHADER_DIR}/*.frag
+                        ${SHADER_DIR}/*.geom
+                        ${SHADER_DIR}/*.vert)
+
+set (ARRAYS "")
+set (ENTRIES "")
+foreach (SHADER_FILE ${SHADER_FILES})
+    get_filename_component (SHADER_NAME ${SHADER_FILE} NAME)
+    string (MAKE_C_IDENTIFIER "shader_${SHADER_NAME}" IDENTIFIER)
+
+    # Byte arrays avoid the string literal length limits of some compilers
+    file (READ ${SHADER_FILE} SHADER_HEX HEX)
+    string (REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," SHADER_BYTES "${SHADER_HEX}")
+    string (REGEX REPLACE "(0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,)" "\\1\n    " SHADER_BYTES "${SHADER_BYTES}")
+
+    set (ARRAYS "${ARRAYS}static const unsigned char ${IDENTIFIER}[] = {\n    ${SHADER_BYTES}0x00\n};\n\n")
+    set (ENTRIES "${ENTRIES}    { \"${SHADER_NAME}\", reinterpret_cast<const char*>(${IDENTIFIER}), sizeof(${IDENTIFIER}) - 1 },\n")
+endforeach ()
+
+set (CONTENT "// Generated from ${SHADER_DIR} by cmake/embedShaders.cmake. Do not edit.\n")
+set (CONTENT "${CONTENT}#pragma once\n\n#include <cstddef>\n\n")
+set (CONTENT "${CONTENT}struct EmbeddedShader {\n    const char* name;\n    const char* source;\n    size_t size;\n};\n\n")
+set (CONTENT "${CONTENT}${ARRAYS}")
+set (CONTENT "${CONTENT}static const EmbeddedShader embeddedShaders[] = {\n${ENTRIES}    { nullptr, nullptr, 0 }\n};\n")
+
+# Only touch the header when a shader changed, to avoid needless rebuilds
+if (EXISTS ${OUTPUT})
+    file (READ ${OUTPUT} OLD_CONTENT)
+endif ()
+if (NOT "${OLD_CONTENT}" STREQUAL "${CONTENT}")
+    file (WRITE ${OUTPUT} "${CONTENT}")
+endif ()
@@ -0,0 +1,138 @@
+#version 430 core
+
+// Reconstructs a full frame from a checkerboard frame, where only every other pixel was traced.
+// Missing pixels are reprojected into the previous reconstructed frame using the camera movement and the
+// depth of their traced neighbours, and interpolated from those neighbours where the reprojection fails.
+
+const float FOV = 2.0;		// Must match simple.frag
+
+uniform layout(location = 0) vec2 imageResolution;
+
+// Half of the pixels traced this frame, see checkerboardPhase in simple.frag
+uniform layout(location = 1) int checkerboardPhase;
+
+uniform layout(location = 2) vec3 cameraPosition;
+uniform layout(location = 3) mat4 cameraToWorld;
+
+// Camera of the previous frame
+uniform layout(location = 4) vec3 previousCameraPosition;
+uniform layout(location = 5) mat4 previousWorldToCamera;
+
+// Zero when there is no usable previous frame, e.g. after a resize
+uniform layout(location = 6) int historyValid;
+
+// Non-zero when the camera and scene are unchanged since the previous frame, which traced exactly the pixels
+// missing in this one. They are copied without reprojection, so the image converges at silhouettes as well
+uniform layout(location = 7) int historyExact;
+
+// Half width images written by simple.frag
+layout(binding = 0) uniform sampler2D traceColor;
+layout(binding = 1) uniform sampler2D traceHit;
+
+// Previous reconstructed frame
+layout(binding = 2) uniform sampler2D historyColor;
+layout(binding = 3) uniform sampler2D historyHit;
+
+layout(location = 0) out vec4 color;
+layout(location = 1) out vec2 hitInfo;
+
+bool isTraced(ivec2 pixel)
+{
+	return (pixel.x & 1) == ((pixel.y + checkerboardPhase) & 1);
+}
+
+// Colour and hit of a pixel traced this frame. Pixels outside the image use the closest traced pixel
+void fetchTraced(ivec2 pixel, out vec4 col, out vec2 hit)
+{
+	pixel = clamp(pixel, ivec2(0), ivec2(imageResolution) - 1);
+	ivec2 texel = ivec2(pixel.x / 2, pixel.y);
+	col = texelFetch(traceColor, texel, 0);
+	hit = texelFetch(traceHit, texel, 0).xy;
+}
+
+// Same ray as simple.frag generates for a pixel
+vec3 rayDirection(vec2 pixel)
+{
+	vec2 fragPos = (pixel / imageResolution) * 2.0 - 1.0;
+	fragPos.x *= imageResolution.x / imageResolution.y;
+	return normalize(vec3(cameraToWorld * vec4(fragPos, FOV, 0.0)));
+}
+
+// Inverse of rayDirection for the previous camera. Returns false for points behind it
+bool previousPixel(vec3 worldPos, out vec2 pixel)
+{
+	vec3 cameraPos = vec3(previousWorldToCamera * vec4(worldPos - previousCameraPosition, 0.0));
+	vec2 fragPos = cameraPos.xy * FOV / cameraPos.z;
+	fragPos.x /= imageResolution.x / imageResolution.y;
+	pixel = (fragPos + 1.0) * 0.5 * imageResolution;
+	return cameraPos.z > 0.0;
+}
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	if (isTraced(pixel)) {
+		fetchTraced(pixel, color, hitInfo);
+		return;
+	}
+
+	if (historyExact != 0) {
+		color = texelFetch(historyColor, pixel, 0);
+		hitInfo = texelFetch(historyHit, pixel, 0).xy;
+		return;
+	}
+
+	// All four direct neighbours of a missing pixel were traced this frame
+	vec4 colors[4];
+	vec2 hits[4];
+	fetchTraced(pixel + ivec2(-1, 0), colors[0], hits[0]);
+	fetchTraced(pixel + ivec2( 1, 0), colors[1], hits[1]);
+	fetchTraced(pixel + ivec2( 0,-1), colors[2], hits[2]);
+	fetchTraced(pixel + ivec2( 0, 1), colors[3], hits[3]);
+
+	// Assume the missing pixel shows the closest neighbour's surface, so silhouettes keep the foreground
+	int nearest = 0;
+	for (int i = 1; i < 4; i++) {
+		nearest = (hits[i].x < hits[nearest].x) ? i : nearest;
+	}
+	vec2 hit = hits[nearest];
+
+	// Spatial fallback: interpolate along the axis with the smaller colour difference, so edges are not blurred across
+	float horizontalDifference = length(colors[0].rgb - colors[1].rgb);
+	float verticalDifference = length(colors[2].rgb - colors[3].rgb);
+	vec4 spatial = (horizontalDifference < verticalDifference) ? 0.5 * (colors[0] + colors[1]) : 0.5 * (colors[2] + colors[3]);
+
+	color = spatial;
+	hitInfo = hit;
+	if (historyValid == 0) {
+		return;
+	}
+
+	// Reproject the surface point into the previous frame
+	vec3 worldPos = cameraPosition + rayDirection(vec2(pixel) + 0.5) * hit.x;
+	vec2 reprojected;
+	if (!previousPixel(worldPos, reprojected)) {
+		return;
+	}
+	ivec2 previous = ivec2(floor(reprojected));
+	if (any(lessThan(previous, ivec2(0))) || any(greaterThanEqual(previous, ivec2(imageResolution)))) {
+		return;
+	}
+
+	// The previous frame has to have seen the same object at the same distance, otherwise the point was occluded there
+	vec2 previousHit = texelFetch(historyHit, previous, 0).xy;
+	float expectedDistance = distance(worldPos, previousCameraPosition);
+	bool sameObject = previousHit.y == hit.y;
+	bool sameSurface = abs(previousHit.x - expectedDistance) < 0.05 * expectedDistance + 0.05;
+	if (!sameObject || !sameSurface) {
+		return;
+	}
+
+	// The sea moves between frames, so clamp it to the neighbourhood to keep waves from leaving trails
+	color = texelFetch(historyColor, previous, 0);
+	if (hit.y == 4.0) {
+		vec4 minColor = min(min(colors[0], colors[1]), min(colors[2], colors[3]));
+		vec4 maxColor = max(max(colors[0], colors[1]), max(colors[2], colors[3]));
+		color = clamp(color, minColor, maxColor);
+	}
+}
@@ -0,0 +1,11 @@
+#version 430 core
+
+// Shows a frame that was raymarched earlier
+layout(binding = 0) uniform sampler2D frame;
+
+out vec4 color;
+
+void main()
+{
+	color = texelFetch(frame, ivec2(gl_FragCoord.xy), 0);
+}
@@ -22,19 +22,90 @@ vec3 objectColors[] = {
 #define PI 3.1415926535897932384626433832795
 
 #define MAX_LIGHTS 3
+#define MAX_VIEWS 8
 
 uniform layout(location = 0) vec2 imageResolution;
 
 uniform layout(location = 1) float time;
 
-uniform layout(location = 2) vec3 cameraPosition;
-
-uniform layout(location = 3) mat4 rotMatrix;
+uniform layout(location = 2) int numViews;
 
 uniform layout(location = 4) int numLights;
 
+// Level of detail settings for the current quality tier:
+// x = max number of sea octaves, y = pixel footprint where sea octaves start dropping, z = pixel footprint where column detail starts fading
+uniform layout(location = 5) vec3 lodSettings;
+
+// Checkerboard rendering: which half of the pixels this frame traces (0 or 1), or -1 to trace every pixel.
+// The render target is then half as wide as the image, and each fragment traces one pixel of its pair
+uniform layout(location = 6) int checkerboardPhase;
+
+// Sea reflections: x = resolution divisor of the reflection buffer, y = step budget of reflected rays
+uniform layout(location = 7) vec2 reflectionSettings;
+
+// Non-zero while rendering the reflection buffer instead of the image
+uniform layout(location = 8) int reflectionPass;
+
+// Reflections of the objects in the sea, written by the reflection pass: premultiplied colour with coverage, and sea distance
+layout(binding = 4) uniform sampler2D reflectionColor;
+layout(binding = 5) uniform sampler2D reflectionDepth;
+
+// Cached soft shadows. Each light has a volume over the temple holding calculateSoftShadow towards the light,
+// usable when the light's bit is set in cachedShadowMask
+layout(binding = 6) uniform sampler3D shadowVolumes[MAX_LIGHTS];
+uniform layout(location = 9) int cachedShadowMask;
+
+// Light and slice of the shadow volume being built, or x = -1 while rendering the image
+uniform layout(location = 10) ivec2 shadowVolumeBuild;
+
+// Parts of mapWorld, as bits of the tile pruning masks. Must match ScenePart in tilePruning.hpp
+#define PART_GROUND 1
+#define PART_COLUMNS 2
+#define PART_COLUMN_GAP 4		// The box removing one row of columns
+#define PART_FLOOR 8
+#define PART_FLOOR_GAP 16		// The box removing one row of floor tiles
+#define PART_ROOF 32
+#define ALL_PARTS 63
+
+// Parts that can be the nearest surface of a primary ray inside the scene bounds, per screen tile. Computed on the CPU
+// when the views change (see tilePruning.cpp). pruneTileSize is the tile size in pixels, or 0 when every part is evaluated
+layout(binding = 9) uniform usampler2D tileParts;
+uniform layout(location = 11) int pruneTileSize;
+
+// Sea surface shared by all views, baked once per frame around the main camera: r = wave height, gba = normal.
+// Each layer is a square cascade SEA_CASCADE_RATIO times as wide as the one before. Sizes must match gamelogic.cpp
+#define SEA_CASCADES 4
+#define SEA_HEIGHTFIELD_SIZE 1024
+const float SEA_CASCADE_WIDTH = 32.0;		// Width of the finest cascade in world units
+const float SEA_CASCADE_RATIO = 4.0;
+layout(binding = 10) uniform sampler2DArray seaHeightfield;
+uniform layout(location = 13) vec3 seaBakeCamera;
+uniform layout(location = 14) int seaHeightfieldValid;
+
+// Cascade of the sea heightfield being baked, or -1 while rendering the image
+uniform layout(location = 12) int seaBakeCascade;
+
 uniform PointLight pointLights[MAX_LIGHTS];
 
+// All views of the frame. Each view is rendered to its own tile, side by side along x
+struct View {
+	vec4 position;
+	mat4 cameraToWorld;
+};
+
+layout(std140, binding = 0) uniform ViewBlock {
+	View views[MAX_VIEWS];
+};
+
+// Position of the view this fragment belongs to (set in main)
+vec3 cameraPosition;
+
+// Full resolution pixel this fragment traces (set in main)
+vec2 pixel;
+
+// Parts of the scene the primary ray of this fragment can hit (set in main)
+int visibleParts;
+
 const float ambientStrength = 0.35;
 const float specularStrength = 0.25;
 
@@ -48,7 +119,17 @@ const vec3 SEA_COLOR = vec3(0.8,0.9,0.6);
 const float MAX_HEIGHT_SEA = 5.0;
 const float SEA_LEVEL = 3.7;
 
-out vec4 color;
+// Bounds of everything in mapWorld. Reflected rays that leave them can only reach the sky
+const vec3 SCENE_BOUNDS_MIN = vec3(-25.0, -8.0, -25.0);
+const vec3 SCENE_BOUNDS_MAX = vec3(25.0, 2.5, 25.0);
+
+// Region covered by the shadow volumes: columns, floor and roof, but not the ground under the sea
+const vec3 SHADOW_VOLUME_MIN = vec3(-10.5, -4.0, -8.5);
+const vec3 SHADOW_VOLUME_MAX = vec3(10.5, 2.6, 2.5);
+const ivec3 SHADOW_VOLUME_SIZE = ivec3(210, 66, 110);		// Voxels, must match SHADOW_VOLUME_SIZE in gamelogic.h
+
+layout(location = 0) out vec4 color;
+layout(location = 1) out vec2 hitInfo;		// Distance to the hit and its object ID (4 = sea, -1 = sky), used for reprojection
 /*======================================================================================*/
 // Noise functions
 
@@ -151,17 +232,20 @@ float torusSDF(vec3 point, vec2 thickness)
   return length(q) - thickness.y;
 }
 /*======================================================================================*/
+// Level of detail
 
-vec2 mapWorld(in vec3 point)
+// Approximate world-space size of one pixel at the given point
+float pixelFootprint(in vec3 point)
 {
-	
-	// Ground
-	vec3 groundLevel = vec3(0.0, -7.0, 0.0);
-    vec2 res = vec2(boxSDF(point - groundLevel,  vec3(25.0, 1.0, 25.0)), 0.0);  // vec2 = [distance, ObjectID]
+	// Rays span [-1, 1] over the image height at distance FOV
+	return distance(point, cameraPosition) * 2.0 / (FOV * imageResolution.y);
+}
 
-	/*---------- Roman Column -----------*/
-	vec3 columnPoint = opRepeatLim(point, 4.35, vec3(2.0, 0.0, 1.0));
-	columnPoint = vec3(columnPoint.x, abs(columnPoint.y) + 0.2, columnPoint.z);
+/*======================================================================================*/
+
+// Fluted column with torus capital, used up close
+vec2 columnDetailSDF(in vec3 columnPoint)
+{
 	float angle = 2 * PI / 24.0;
 	float sector = round(atan(columnPoint.z, columnPoint.x)/angle);
 	vec3 rotatedPoint = columnPoint;
@@ -172,33 +256,83 @@ vec2 mapWorld(in vec3 point)
 	vec2 column = opDifference(vec2(cylinderSDF(columnPoint - vec3(0.0, 0.0, 0.0), 2.0, 0.3), 1.0), vec2(cylinderSDF(rotatedPoint - vec3(0.3, 0.0, 0.0), 2.0, 0.02), 1.0));
 
 		// Cylinder top
-	column = sMin(column, opDifference(vec2(cylinderSDF(columnPoint - vec3(0.0, 2.0, 0.0), 0.05, 0.45) - 0.02, 1.0), vec2(torusSDF(columnPoint - vec3(0.0, 1.80, 0.0), vec2(0.63, 0.29)), 1.0)), 0.5);
+	return sMin(column, opDifference(vec2(cylinderSDF(columnPoint - vec3(0.0, 2.0, 0.0), 0.05, 0.45) - 0.02, 1.0), vec2(torusSDF(columnPoint - vec3(0.0, 1.80, 0.0), vec2(0.63, 0.29)), 1.0)), 0.5);
+}
 
-		// Box top
-	column = opUnion(column, vec2(boxSDF(columnPoint - vec3(0.0, 2.14, 0.0),  vec3(0.5, 0.08, 0.5)) - 0.02, 1.0));
+// Column collapsed to its bounding cylinders, used when flutes and capital are smaller than a pixel
+vec2 columnBoundSDF(in vec3 columnPoint)
+{
+	vec2 column = vec2(cylinderSDF(columnPoint, 2.0, 0.3), 1.0);
+	return opUnion(column, vec2(cylinderSDF(columnPoint - vec3(0.0, 2.0, 0.0), 0.05, 0.45) - 0.02, 1.0));
+}
+
+// Distance to the given parts of the scene (PART_* bits). Parts that are left out must not be the nearest surface.
+// Mirrored in src/pruning/tilePruning.cpp and tests/pruningBounds.cpp
+vec2 mapScene(in vec3 point, in int parts)
+{
+	vec2 res = vec2(FLT_MAX, 0.0);		// vec2 = [distance, ObjectID]
+
+	// Ground
+	if ((parts & PART_GROUND) != 0) {
+		vec3 groundLevel = vec3(0.0, -7.0, 0.0);
+		res = opUnion(res, vec2(boxSDF(point - groundLevel,  vec3(25.0, 1.0, 25.0)), 0.0));
+	}
+
+	/*---------- Roman Column -----------*/
+	if ((parts & PART_COLUMNS) != 0) {
+		vec3 columnPoint = opRepeatLim(point, 4.35, vec3(2.0, 0.0, 1.0));
+		columnPoint = vec3(columnPoint.x, abs(columnPoint.y) + 0.2, columnPoint.z);
+
+			// Fade from full detail to the bounding shape over one doubling of the pixel footprint
+		float detailFade = smoothstep(lodSettings.z, 2.0 * lodSettings.z, pixelFootprint(point));
+		vec2 column;
+		if (detailFade <= 0.0) {
+			column = columnDetailSDF(columnPoint);
+		} else if (detailFade >= 1.0) {
+			column = columnBoundSDF(columnPoint);
+		} else {
+			column = vec2(mix(columnDetailSDF(columnPoint).x, columnBoundSDF(columnPoint).x, detailFade), 1.0);
+		}
+
+			// Box top
+		column = opUnion(column, vec2(boxSDF(columnPoint - vec3(0.0, 2.14, 0.0),  vec3(0.5, 0.08, 0.5)) - 0.02, 1.0));
+
+		if ((parts & PART_COLUMN_GAP) != 0) {
+			column = opDifference(column, vec2(boxSDF(point - vec3(0.0, 0.0, 5.0),  vec3(10.0, 2.5, 2.0)), 1.0));		// Remove one row of columns
+		}
+
+		res = opUnion(res, column);
+	}
 
-	column = opDifference(column, vec2(boxSDF(point - vec3(0.0, 0.0, 5.0),  vec3(10.0, 2.5, 2.0)), 1.0));		// Remove one row of columns
-	
-	res = opUnion(res, column);
-	
 	/*---------- First level floor -----------*/
-	vec3 floorPoint = opRepeatLim(point - vec3(0.0, -2.0, -2.90), 1.45, vec3(7.0, 0.0, 3.0));
-	vec2 floor = vec2(boxSDF(floorPoint,  vec3(0.7, 0.05, 0.7)) - 0.03, 2.0);
-	floor = opDifference(floor, vec2(boxSDF(point - vec3(0.0, -2.0, -7.27),  vec3(11.0, 0.5, 0.75)), 2.0));		// Remove one row of tiles
+	if ((parts & PART_FLOOR) != 0) {
+		vec3 floorPoint = opRepeatLim(point - vec3(0.0, -2.0, -2.90), 1.45, vec3(7.0, 0.0, 3.0));
+		vec2 floor = vec2(boxSDF(floorPoint,  vec3(0.7, 0.05, 0.7)) - 0.03, 2.0);
+		if ((parts & PART_FLOOR_GAP) != 0) {
+			floor = opDifference(floor, vec2(boxSDF(point - vec3(0.0, -2.0, -7.27),  vec3(11.0, 0.5, 0.75)), 2.0));		// Remove one row of tiles
+		}
 
-	res = opUnion(res, floor);
+		res = opUnion(res, floor);
+	}
 
 	/*---------- First level roof -----------*/
-	vec3 roofOrigin = vec3(0.0, 2.1, -2.2);
-	vec2 roof = vec2(boxSDF(point - roofOrigin,  vec3(9.6, 0.1, 3.0)) - 0.03, 3.0);
+	if ((parts & PART_ROOF) != 0) {
+		vec3 roofOrigin = vec3(0.0, 2.1, -2.2);
+		vec2 roof = vec2(boxSDF(point - roofOrigin,  vec3(9.6, 0.1, 3.0)) - 0.03, 3.0);
 
-	res = opUnion(res, roof);
+		res = opUnion(res, roof);
+	}
 
 	return res;
 }
 
-// Computes distance straight down to sea from a given point (y-direction)
-float getSeaDist(vec3 point)
+vec2 mapWorld(in vec3 point)
+{
+	return mapScene(point, ALL_PARTS);
+}
+
+// Evaluates the sea waves to get the distance straight down to sea from a given point (y-direction)
+float evaluateSeaDist(vec3 point)
 {
 	vec2 uv = vec2(point.x, point.z);		// xy-grid for heightmap
 
@@ -209,11 +343,15 @@ float getSeaDist(vec3 point)
 	float wave = 0.0;
 	float height = 0.0;
 
-	for(int i = 0; i < 5; i++)
+	// Drop one octave each time the pixel footprint grows by the octave frequency step. The last octave fades in to avoid popping
+	float octaves = lodSettings.x - log2(max(pixelFootprint(point) / lodSettings.y, 1.0)) / log2(1.83);
+	octaves = clamp(octaves, 1.0, lodSettings.x);
+
+	for(int i = 0; i < int(ceil(octaves)); i++)
 	{
 		wave = generateOctave((uv + (time*0.55)) * frequency, choppiness);		// Vary with time for movement
 		wave += generateOctave((uv - (time*0.55)) * frequency, choppiness);
-		height += wave * amplitude;
+		height += wave * amplitude * clamp(octaves - float(i), 0.0, 1.0);
 		uv *= mat2(1.4, -1.3, 1.1, 1.5);		// Create assymmetry by multiplying with some random values
 
 		amplitude *= 0.20;					// Finer detail in later iterations -> decrease amplitude and frequency
@@ -240,19 +378,55 @@ vec3 calculateNormal(in vec3 point)
 }
 
 /* Need a separate function to calculate normals for sea (for now) */
-vec3 calculateSeaNormal(in vec3 point)
+vec3 evaluateSeaNormal(in vec3 point)
 {
 	const float perturbation = 0.001;
 
 	vec3 normal;
-	float height = getSeaDist(point);
-	normal.y = getSeaDist(vec3(point.x, point.y + perturbation, point.z)) - height;
-	normal.x = getSeaDist(vec3(point.x + perturbation, point.y, point.z)) - height;
-	normal.z = getSeaDist(vec3(point.x, point.y, point.z + perturbation)) - height;
+	float height = evaluateSeaDist(point);
+	normal.y = evaluateSeaDist(vec3(point.x, point.y + perturbation, point.z)) - height;
+	normal.x = evaluateSeaDist(vec3(point.x + perturbation, point.y, point.z)) - height;
+	normal.z = evaluateSeaDist(vec3(point.x, point.y, point.z + perturbation)) - height;
 
 	return normalize(normal);
 }
 
+// Texture coordinate of a point of the xz-plane in the finest baked sea cascade that holds it.
+// Returns false when the heightfield is not baked or the point lies outside the coarsest cascade
+bool seaHeightfieldCoord(in vec2 xz, out vec3 coord)
+{
+	vec2 offset = xz - seaBakeCamera.xz;
+
+	// Stay one texel inside the cascade border, so bilinear filtering does not clamp to the edge
+	float width = 2.0 * max(max(abs(offset.x), abs(offset.y)), 0.001) / (1.0 - 2.0 / float(SEA_HEIGHTFIELD_SIZE));
+	float cascade = max(ceil(log(width / SEA_CASCADE_WIDTH) / log(SEA_CASCADE_RATIO)), 0.0);
+	if (seaHeightfieldValid == 0 || cascade >= float(SEA_CASCADES)) {
+		return false;
+	}
+
+	coord = vec3(offset / (SEA_CASCADE_WIDTH * pow(SEA_CASCADE_RATIO, cascade)) + 0.5, cascade);
+	return true;
+}
+
+// Computes distance straight down to sea from a given point (y-direction), from the baked heightfield when it holds the point
+float getSeaDist(vec3 point)
+{
+	vec3 coord;
+	if (seaHeightfieldCoord(point.xz, coord)) {
+		return (point.y - textureLod(seaHeightfield, coord, 0.0).r) + SEA_LEVEL;
+	}
+	return evaluateSeaDist(point);
+}
+
+vec3 calculateSeaNormal(in vec3 point)
+{
+	vec3 coord;
+	if (seaHeightfieldCoord(point.xz, coord)) {
+		return normalize(textureLod(seaHeightfield, coord, 0.0).gba);
+	}
+	return evaluateSeaNormal(point);
+}
+
 /*======================================================================================*/
 
 // Penumbra shadows from : https://www.iquilezles.org/www/articles/rmshadows/rmshadows.htm
@@ -277,6 +451,45 @@ float calculateSoftShadow(in vec3 origin, in vec3 rayDir, in float minDist, in f
     return clamp(res, 0.3, 1.0 );		// Set a lower limit on shadow 
 }
 
+// Soft shadow towards a light, looked up in its cached volume when possible and marched otherwise
+float getSoftShadow(in int light, in vec3 point, in vec3 normal, in vec3 lightDir)
+{
+	vec3 coord = (point - SHADOW_VOLUME_MIN) / (SHADOW_VOLUME_MAX - SHADOW_VOLUME_MIN);
+	bool inside = all(greaterThanEqual(coord, vec3(0.0))) && all(lessThanEqual(coord, vec3(1.0)));
+	if ((cachedShadowMask & (1 << light)) != 0 && inside) {
+		// Look up a little off the surface, so voxels inside the geometry do not darken it
+		coord = (point + normal * 0.15 - SHADOW_VOLUME_MIN) / (SHADOW_VOLUME_MAX - SHADOW_VOLUME_MIN);
+		return textureLod(shadowVolumes[light], coord, 0.0).r;
+	}
+	return calculateSoftShadow(point, lightDir, 0.1, 3.0);
+}
+
+// Shadow volume pass: soft shadow towards one light at the centre of a voxel of the current slice
+void buildShadowVoxel()
+{
+	vec3 voxel = vec3(gl_FragCoord.xy, float(shadowVolumeBuild.y) + 0.5);
+	vec3 point = SHADOW_VOLUME_MIN + voxel / vec3(SHADOW_VOLUME_SIZE) * (SHADOW_VOLUME_MAX - SHADOW_VOLUME_MIN);
+
+	// A zero pixel footprint keeps the geometry at full detail, so the volume does not depend on the camera
+	cameraPosition = point;
+
+	vec3 lightDir = normalize(pointLights[shadowVolumeBuild.x].position - point);
+	color = vec4(calculateSoftShadow(point, lightDir, 0.1, 3.0));
+}
+
+// Sea bake pass: wave height and normal at the centre of a texel of the current cascade
+void bakeSeaTexel()
+{
+	float width = SEA_CASCADE_WIDTH * pow(SEA_CASCADE_RATIO, float(seaBakeCascade));
+	vec2 xz = seaBakeCamera.xz + (gl_FragCoord.xy / float(SEA_HEIGHTFIELD_SIZE) - 0.5) * width;
+	vec3 point = vec3(xz.x, -SEA_LEVEL, xz.y);
+
+	// The octave count follows the pixel footprint seen from the main camera
+	cameraPosition = seaBakeCamera;
+
+	color = vec4(point.y + SEA_LEVEL - evaluateSeaDist(point), evaluateSeaNormal(point));
+}
+
 // Phong shading from previous assignment deliveries
 vec3 phongShading(in vec3 currentPos, int candidateObj, in vec3 ray)
 {
@@ -294,7 +507,7 @@ vec3 phongShading(in vec3 currentPos, int candidateObj, in vec3 ray)
 		float lightDistance = length(pointLights[i].position - currentPos);
 		float lightAttenuation = 1.0 / (constant + linear * lightDistance + quadratic * (lightDistance * lightDistance));
 
-		float shadow = calculateSoftShadow(currentPos, lightDir, 0.1, 3.0);
+		float shadow = getSoftShadow(i, currentPos, normal, lightDir);
 
 		float diff = clamp(max(dot(lightDir, normal), 0.0) * lightAttenuation, 0.0, 1.0) * shadow;
 		float spec = clamp(pow(max(dot(normalize(ray), reflectDir), 0.0), 32) * lightAttenuation, 0.0, 1.0) * shadow; 
@@ -317,6 +530,32 @@ vec3 getSkyColor(in vec3 rayDir)
 	return col;
 }
 
+// Upsamples the reflection buffer. Bilinear weights are scaled down for texels that saw the sea at a different
+// distance, so reflections do not bleed across objects standing in the sea or across the horizon
+vec4 sampleReflection(in float seaDist)
+{
+	vec2 coord = pixel / reflectionSettings.x - 0.5;
+	ivec2 base = ivec2(floor(coord));
+	vec2 weights = fract(coord);
+	ivec2 maxTexel = textureSize(reflectionColor, 0) - 1;
+
+	vec4 sum = vec4(0.0);
+	float weightSum = 0.0;
+	for (int i = 0; i < 4; i++) {
+		ivec2 offset = ivec2(i & 1, i >> 1);
+		ivec2 texel = clamp(base + offset, ivec2(0), maxTexel);
+		vec2 bilinear = mix(1.0 - weights, weights, vec2(offset));
+		float depth = texelFetch(reflectionDepth, texel, 0).x;
+		float weight = (bilinear.x * bilinear.y + 0.001) / (0.01 + abs(depth - seaDist) / seaDist);
+		sum += texelFetch(reflectionColor, texel, 0) * weight;
+		weightSum += weight;
+	}
+
+	// Near the horizon the reduced resolution rays of all four texels can pass above the sea and store FLT_MAX,
+	// although this pixel hits it. Their weights underflow to zero, so there is no coverage
+	return (weightSum > 0.0) ? sum / weightSum : vec4(0.0);
+}
+
 vec3 getSeaColor(in vec3 cameraPos, in vec3 currentPos, in vec3 ray, in float seaDist)
 {
 	vec3 normal = calculateSeaNormal(currentPos);
@@ -346,7 +585,8 @@ vec3 getSeaColor(in vec3 cameraPos, in vec3 currentPos, in vec3 ray, in float se
 	}
 
 	vec3 refraction = vec3(0.13, 0.21, 0.21) * (ambient + diffuse) + SEA_COLOR * diffuse * 0.1;
-	vec3 reflection = getSkyColor(reflect(ray, normal));		// Only sky reflection for now
+	vec4 objectReflection = sampleReflection(seaDist);
+	vec3 reflection = getSkyColor(reflect(ray, normal)) * (1.0 - objectReflection.a) + objectReflection.rgb;
 
 	// Light gets attenuated more when traveling through water
 	float waterAttenuation = max(0.0, 1.0 - exp(seaDist * 0.25) * 0.006) * 0.08 / (1.0 + seaDist * 0.001);		// A bit hacky, but gives a decent result. At a distance we can only see wavetops, so I attenuate less further away for consistency
@@ -361,40 +601,25 @@ vec3 getSeaColor(in vec3 cameraPos, in vec3 currentPos, in vec3 ray, in float se
 	return col;
 }
 
-vec3 rayMarch(in vec3 origin, in vec3 dir)
+// Distance along the ray to the sea surface, or FLT_MAX if the ray never goes below it
+float traceSea(in vec3 origin, in vec3 dir, out vec3 currentSeaPos)
 {
-	const int N_STEPS = 140;
-	const float MIN_HIT_DIST = 0.0001;
-	const float MAX_RAY_DIST = 1000.0;
-
-	int step = 0;
-
-	vec3 currentPos = origin;
-	vec2 toClosestDist = mapWorld(currentPos);
-	float distTraveled = 0.0;
-
-	vec3 candidatePos = origin;
-	float candidateError = FLT_MAX;
-	int candidateObj = 0;
-
-	// First we raymarch sea
-
 	const int N_STEPS_SEA = 10;
-	vec3 currentSeaPos = origin;
+	currentSeaPos = origin;
 	float stepSize = 0.0;		
 	float farDist = 1000.0;				// tx
 	float nearDist = 0.0;				// tm
 	float seaDist = FLT_MAX;
 
 	// If point at max distance along ray is above water, we know that the ray will hit sky or an object, so we can skip sea tracing
-	float maxSeaDist = getSeaDist(currentPos + farDist * dir);	// hx
+	float maxSeaDist = getSeaDist(origin + farDist * dir);	// hx
 	if (maxSeaDist > 0.0) {
-		step = N_STEPS_SEA +1; //return getSkyColor(dir);
-		}
+		return FLT_MAX;
+	}
 
 	float startHeight = getSeaDist(currentSeaPos);				//hm
 
-	while (step < N_STEPS_SEA)
+	for (int step = 0; step < N_STEPS_SEA; step++)
 	{
 	
 		// The size of the step we take depends on the height of the camera above the sea.
@@ -417,10 +642,80 @@ vec3 rayMarch(in vec3 origin, in vec3 dir)
 			startHeight = newDist;
 		}
 		seaDist = stepSize;				// Distance from camera to sea hit
-		step++;
 	}
+	return seaDist;
+}
+
+bool insideSceneBounds(in vec3 point)
+{
+	return all(greaterThanEqual(point, SCENE_BOUNDS_MIN)) && all(lessThanEqual(point, SCENE_BOUNDS_MAX));
+}
+
+// Entry and exit distance of a ray through the scene bounds. Entry is greater than exit when the ray misses them
+vec2 intersectSceneBounds(in vec3 origin, in vec3 dir)
+{
+	vec3 inverseDir = 1.0 / dir;
+	vec3 t0 = (SCENE_BOUNDS_MIN - origin) * inverseDir;
+	vec3 t1 = (SCENE_BOUNDS_MAX - origin) * inverseDir;
+	vec3 tNear = min(t0, t1);
+	vec3 tFar = max(t0, t1);
+	return vec2(max(max(tNear.x, tNear.y), max(tNear.z, 0.0)), min(min(tFar.x, tFar.y), tFar.z));
+}
+
+// Reflection pass: marches the reflection of a primary ray off the sea against the objects, with the reduced step
+// budget of the quality tier. Writes the premultiplied object colour with its coverage, and the sea distance
+void traceReflection(in vec3 origin, in vec3 dir)
+{
+	const float MIN_HIT_DIST = 0.001;
+
+	vec3 seaPos;
+	float seaDist = traceSea(origin, dir, seaPos);
+	color = vec4(0.0);
+	hitInfo = vec2(seaDist, 4.0);
+	if (seaDist == FLT_MAX) {
+		return;
+	}
+
+	// Rays that miss the scene bounds only reflect sky, which the main pass adds at full resolution
+	vec3 reflectDir = reflect(dir, calculateSeaNormal(seaPos));
+	vec2 bounds = intersectSceneBounds(seaPos, reflectDir);
+	if (bounds.x >= bounds.y) {
+		return;
+	}
+
+	float distTraveled = bounds.x;
+	int maxSteps = int(reflectionSettings.y);
+	for (int step = 0; step < maxSteps && distTraveled < bounds.y; step++)
+	{
+		vec3 currentPos = seaPos + reflectDir * distTraveled;
+		vec2 toClosestDist = mapWorld(currentPos);
+		if (toClosestDist.x < MIN_HIT_DIST * (1.0 + distTraveled)) {
+			color = vec4(phongShading(currentPos, int(toClosestDist.y), reflectDir), 1.0);
+			return;
+		}
+		distTraveled += toClosestDist.x;
+	}
+}
+
+vec3 rayMarch(in vec3 origin, in vec3 dir, out vec2 hit)
+{
+	const int N_STEPS = 140;
+	const float MIN_HIT_DIST = 0.0001;
+	const float MAX_RAY_DIST = 1000.0;
+
+	int step = 0;
 
-	//return getSeaColor(origin, currentSeaPos, dir, seaDist);
+	vec3 currentPos = origin;
+	vec2 toClosestDist = mapWorld(currentPos);
+	float distTraveled = 0.0;
+
+	vec3 candidatePos = origin;
+	float candidateError = FLT_MAX;
+	int candidateObj = 0;
+
+	// First we raymarch sea
+	vec3 currentSeaPos;
+	float seaDist = traceSea(origin, dir, currentSeaPos);
 
 	// Now we raymarch objects
 	step = 0;
@@ -430,8 +725,9 @@ vec3 rayMarch(in vec3 origin, in vec3 dir)
 		// Current position along ray from the origin
         currentPos = origin + distTraveled * dir;
 
-        // Find distance from current position to closest point on a sphere
-        toClosestDist = mapWorld(currentPos);
+        // Find distance from current position to closest point on a sphere. Inside the scene bounds only the parts
+        // that can be nearest in this fragment's tile are evaluated
+        toClosestDist = insideSceneBounds(currentPos) ? mapScene(currentPos, visibleParts) : mapWorld(currentPos);
 		distTraveled += toClosestDist.x;
 
 		// Use smallest circle in case of ray termination due to steps
@@ -443,7 +739,8 @@ vec3 rayMarch(in vec3 origin, in vec3 dir)
 	}
 
 	vec3 col;
-	col = (maxSeaDist > 0.0) ? getSkyColor(dir) : getSeaColor(origin, currentSeaPos, dir, seaDist);
+	col = (seaDist == FLT_MAX) ? getSkyColor(dir) : getSeaColor(origin, currentSeaPos, dir, seaDist);
+	hit = (distTraveled < seaDist) ? vec2(distTraveled, candidateObj) : (seaDist == FLT_MAX) ? vec2(MAX_RAY_DIST, -1.0) : vec2(seaDist, 4.0);
 	return (distTraveled < seaDist) ? phongShading(currentPos, candidateObj, dir) : col;
 }
 
@@ -451,16 +748,47 @@ vec3 rayMarch(in vec3 origin, in vec3 dir)
 /*======================================================================================*/
 void main()
 {
+	if (shadowVolumeBuild.x >= 0) {
+		buildShadowVoxel();
+		return;
+	}
+	if (seaBakeCascade >= 0) {
+		bakeSeaTexel();
+		return;
+	}
+
 	// Generating a ray from the camera (origin) through every pixel
 
+	// Pixel traced by this fragment. The reflection pass covers a block of pixels per fragment and traces from its centre.
+	// In checkerboard mode every fragment covers a horizontal pair of pixels, and the traced one alternates between rows and frames
+	pixel = gl_FragCoord.xy;
+	if (reflectionPass != 0) {
+		pixel = gl_FragCoord.xy * reflectionSettings.x;
+	} else if (checkerboardPhase >= 0) {
+		pixel.x = 2.0 * floor(gl_FragCoord.x) + float((int(gl_FragCoord.y) + checkerboardPhase) & 1) + 0.5;
+	}
+
+	// Find the view tile this fragment belongs to
+	vec2 tileSize = vec2(imageResolution.x / float(numViews), imageResolution.y);
+	int view = min(int(pixel.x / tileSize.x), numViews - 1);
+	vec2 tileCoord = vec2(pixel.x - float(view) * tileSize.x, pixel.y);
+
 	// Move center to (0,0)
-	vec2 fragPos = (gl_FragCoord.xy/ imageResolution.xy) * 2.0 - 1.0;
+	vec2 fragPos = (tileCoord / tileSize) * 2.0 - 1.0;
 	// Correct for image aspect ratio
-	fragPos.x *= imageResolution.x / imageResolution.y;
+	fragPos.x *= tileSize.x / tileSize.y;
+
+	cameraPosition = views[view].position.xyz;
+	vec3 rayDir = vec3(views[view].cameraToWorld * vec4(vec3(fragPos, FOV), 0.0));
+
+	if (reflectionPass != 0) {
+		traceReflection(cameraPosition, normalize(rayDir));
+		return;
+	}
 
-	vec3 rayDir = vec3(inverse(rotMatrix) * vec4(vec3(fragPos, FOV), 1.0));
+	visibleParts = (pruneTileSize > 0) ? int(texelFetch(tileParts, ivec2(pixel) / pruneTileSize, 0).r) : ALL_PARTS;
 
 	float dither = dither(fragPos);
 
-	color = vec4(rayMarch(cameraPosition, normalize(rayDir)) + dither, 1.0);
+	color = vec4(rayMarch(cameraPosition, normalize(rayDir), hitInfo) + dither, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "animation.hpp"
+#include <algorithm>
+#include <cmath>
+
+unsigned int addTrack(AnimationTracks& tracks, glm::vec3* target, const std::vector<float>& times, const std::vector<glm::vec3>& values, bool looping) {
+	unsigned int track = tracks.targets.size();
+	unsigned int count = std::min(times.size(), values.size());
+
+	// A track without keys holds the target's current value
+	if (count == 0) {
+		return addTrack(tracks, target, { 0.0f }, { *target }, false);
+	}
+
+	tracks.targets.push_back(target);
+	tracks.firstKey.push_back(tracks.keyTimes.size());
+	tracks.keyCount.push_back(count);
+	tracks.cursor.push_back(0);
+	tracks.startTime.push_back(times[0]);
+	tracks.loopDuration.push_back((looping && count > 1) ? times[count - 1] - times[0] : 0.0f);
+
+	tracks.segmentKey.push_back(tracks.keyTimes.size());
+	tracks.segmentWeight.push_back(0.0f);
+	tracks.valueX.push_back(values[0].x);
+	tracks.valueY.push_back(values[0].y);
+	tracks.valueZ.push_back(values[0].z);
+
+	for (unsigned int key = 0; key < count; key++) {
+		tracks.keyTimes.push_back(times[key]);
+		tracks.keyX.push_back(values[key].x);
+		tracks.keyY.push_back(values[key].y);
+		tracks.keyZ.push_back(values[key].z);
+	}
+
+	return track;
+}
+
+void evaluateTracks(AnimationTracks& tracks, float time) {
+	unsigned int trackCount = tracks.targets.size();
+
+	// Find the key segment and blend weight of every track
+	for (unsigned int track = 0; track < trackCount; track++) {
+		unsigned int count = tracks.keyCount[track];
+		if (count < 2) {
+			tracks.segmentKey[track] = tracks.firstKey[track];
+			tracks.segmentWeight[track] = 0.0f;
+			continue;
+		}
+
+		const float* keyTimes = &tracks.keyTimes[tracks.firstKey[track]];
+		float localTime = time;
+		if (tracks.loopDuration[track] > 0.0f) {
+			localTime = tracks.startTime[track] + std::fmod(std::fmax(time - tracks.startTime[track], 0.0f), tracks.loopDuration[track]);
+		}
+
+		// Segments only move forward during playback. Start over when time jumps backwards (looping or seeking)
+		unsigned int segment = tracks.cursor[track];
+		if (localTime < keyTimes[segment]) {
+			segment = 0;
+		}
+		while (segment + 2 < count && localTime >= keyTimes[segment + 1]) {
+			segment++;
+		}
+		tracks.cursor[track] = segment;
+
+		float segmentLength = keyTimes[segment + 1] - keyTimes[segment];
+		float weight = (segmentLength > 0.0f) ? (localTime - keyTimes[segment]) / segmentLength : 1.0f;
+		tracks.segmentKey[track] = tracks.firstKey[track] + segment;
+		tracks.segmentWeight[track] = std::fmin(std::fmax(weight, 0.0f), 1.0f);
+	}
+
+	// Interpolate all tracks in one branch-free pass over flat arrays
+	const unsigned int* segmentKey = tracks.segmentKey.data();
+	const float* segmentWeight = tracks.segmentWeight.data();
+	const float* keyX = tracks.keyX.data();
+	const float* keyY = tracks.keyY.data();
+	const float* keyZ = tracks.keyZ.data();
+	float* valueX = tracks.valueX.data();
+	float* valueY = tracks.valueY.data();
+	float* valueZ = tracks.valueZ.data();
+
+	for (unsigned int track = 0; track < trackCount; track++) {
+		// Tracks with a single key use weight zero, so the next key is never read
+		unsigned int key = segmentKey[track];
+		unsigned int next = key + (segmentWeight[track] > 0.0f ? 1 : 0);
+		float weight = segmentWeight[track];
+		valueX[track] = keyX[key] + (keyX[next] - keyX[key]) * weight;
+		valueY[track] = keyY[key] + (keyY[next] - keyY[key]) * weight;
+		valueZ[track] = keyZ[key] + (keyZ[next] - keyZ[key]) * weight;
+	}
+
+	// Write results back to the nodes and lights
+	for (unsigned int track = 0; track < trackCount; track++) {
+		*tracks.targets[track] = glm::vec3(valueX[track], valueY[track], valueZ[track]);
+	}
+}
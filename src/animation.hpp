@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Keyframe tracks for scene graph nodes and lights.
+//
+// Every track linearly interpolates one vec3 (a node's position, rotation or scale, or a light's colour)
+// and writes the result straight into it. Tracks are stored as structure of arrays, so a whole frame is
+// evaluated as a few flat loops with no per-track virtual calls or allocations.
+struct AnimationTracks {
+	// Per track
+	std::vector<glm::vec3*> targets;		// Value written by the track
+	std::vector<unsigned int> firstKey;		// Index of the track's first key in the key arrays
+	std::vector<unsigned int> keyCount;
+	std::vector<unsigned int> cursor;		// Key segment used last frame, so sequential playback finds its segment in O(1)
+	std::vector<float> startTime;
+	std::vector<float> loopDuration;		// Zero for tracks that hold their last key
+
+	// Per track, filled in every frame
+	std::vector<unsigned int> segmentKey;
+	std::vector<float> segmentWeight;
+	std::vector<float> valueX;
+	std::vector<float> valueY;
+	std::vector<float> valueZ;
+
+	// Keys of all tracks, contiguous per track
+	std::vector<float> keyTimes;
+	std::vector<float> keyX;
+	std::vector<float> keyY;
+	std::vector<float> keyZ;
+};
+
+// Adds a track animating the value at target. Key times must be increasing. Looping tracks repeat from their first key
+unsigned int addTrack(AnimationTracks& tracks, glm::vec3* target, const std::vector<float>& times, const std::vector<glm::vec3>& values, bool looping);
+
+// Evaluates every track at the given time and writes the results to their targets
+void evaluateTracks(AnimationTracks& tracks, float time);
@@ -0,0 +1,297 @@
+#include "benchmark.hpp"
+#include "gamelogic.h"
+
+#include <glad/glad.h>
+#include <lodepng.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+// Warm-up renders before timing, so shader compilation and cache misses are not measured
+const int WARMUP_RENDERS = 3;
+
+struct BenchmarkCase {
+	std::string name;
+	CameraPose pose;
+};
+
+struct Baseline {
+	double medianMs;
+	double madMs;
+	int repetitions;
+};
+
+static bool loadCases(const std::string& filename, std::vector<BenchmarkCase>& cases) {
+	std::ifstream file(filename.c_str());
+	if (file.fail()) {
+		fprintf(stderr, "Could not open benchmark cases \"%s\"\n", filename.c_str());
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream values(line);
+		BenchmarkCase benchmarkCase;
+		CameraPose& pose = benchmarkCase.pose;
+		if (values >> benchmarkCase.name >> pose.time >> pose.position.x >> pose.position.y >> pose.position.z >> pose.yaw >> pose.pitch) {
+			cases.push_back(benchmarkCase);
+		}
+	}
+	return !cases.empty();
+}
+
+static std::map<std::string, Baseline> loadBaseline(const std::string& filename) {
+	std::map<std::string, Baseline> baseline;
+	std::ifstream file(filename.c_str());
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream values(line);
+		std::string name;
+		Baseline entry;
+		if (values >> name >> entry.medianMs >> entry.madMs >> entry.repetitions) {
+			baseline[name] = entry;
+		}
+	}
+	return baseline;
+}
+
+static double median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	size_t middle = values.size() / 2;
+	return (values.size() % 2) ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+}
+
+// Median absolute deviation, a spread estimate that ignores the occasional stalled frame
+static double medianAbsoluteDeviation(const std::vector<double>& values, double center) {
+	std::vector<double> deviations;
+	for (double value : values) {
+		deviations.push_back(std::abs(value - center));
+	}
+	return median(deviations);
+}
+
+// Standard error of a median, estimated from the MAD assuming roughly normal noise
+static double medianStandardError(double mad, int repetitions) {
+	return 1.2533 * 1.4826 * mad / std::sqrt(double(std::max(repetitions, 1)));
+}
+
+// Converts an 8-bit sRGB colour to CIELAB (D65), where euclidean distance approximates perceived difference
+static void srgbToLab(const unsigned char* rgb, double lab[3]) {
+	double linear[3];
+	for (int i = 0; i < 3; i++) {
+		double c = rgb[i] / 255.0;
+		linear[i] = (c <= 0.04045) ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+	}
+	double xyz[3] = {
+		(0.4124 * linear[0] + 0.3576 * linear[1] + 0.1805 * linear[2]) / 0.95047,
+		(0.2126 * linear[0] + 0.7152 * linear[1] + 0.0722 * linear[2]) / 1.00000,
+		(0.0193 * linear[0] + 0.1192 * linear[1] + 0.9505 * linear[2]) / 1.08883
+	};
+	for (int i = 0; i < 3; i++) {
+		xyz[i] = (xyz[i] > 0.008856) ? std::cbrt(xyz[i]) : 7.787 * xyz[i] + 16.0 / 116.0;
+	}
+	lab[0] = 116.0 * xyz[1] - 16.0;
+	lab[1] = 500.0 * (xyz[0] - xyz[1]);
+	lab[2] = 200.0 * (xyz[1] - xyz[2]);
+}
+
+// Mean and 99th percentile colour difference between two RGBA8 images of the same size
+static void compareImages(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, double& meanDeltaE, double& percentileDeltaE) {
+	size_t pixelCount = a.size() / 4;
+	std::vector<double> deltaE(pixelCount);
+	double sum = 0.0;
+	for (size_t pixel = 0; pixel < pixelCount; pixel++) {
+		double labA[3], labB[3];
+		srgbToLab(&a[pixel * 4], labA);
+		srgbToLab(&b[pixel * 4], labB);
+		deltaE[pixel] = std::sqrt((labA[0] - labB[0]) * (labA[0] - labB[0])
+								+ (labA[1] - labB[1]) * (labA[1] - labB[1])
+								+ (labA[2] - labB[2]) * (labA[2] - labB[2]));
+		sum += deltaE[pixel];
+	}
+	meanDeltaE = sum / std::max<size_t>(pixelCount, 1);
+
+	size_t percentile = std::min(pixelCount - 1, size_t(pixelCount * 0.99));
+	std::nth_element(deltaE.begin(), deltaE.begin() + percentile, deltaE.end());
+	percentileDeltaE = deltaE[percentile];
+}
+
+// Flips between OpenGL (bottom row first) and image file (top row first) row order
+static std::vector<unsigned char> flipRows(const std::vector<unsigned char>& pixels, int width, int height) {
+	std::vector<unsigned char> flipped(pixels.size());
+	size_t rowSize = size_t(width) * 4;
+	for (int row = 0; row < height; row++) {
+		std::copy(pixels.begin() + (height - 1 - row) * rowSize, pixels.begin() + (height - row) * rowSize, flipped.begin() + row * rowSize);
+	}
+	return flipped;
+}
+
+int runBenchmark(GLFWwindow* window, const BenchmarkSettings& settings) {
+	std::vector<BenchmarkCase> cases;
+	if (!loadCases(settings.casesFile, cases)) {
+		return EXIT_FAILURE;
+	}
+	std::map<std::string, Baseline> baseline = loadBaseline(settings.baselineFile);
+
+	initGame(window);
+
+	GLuint timerQuery;
+	glGenQueries(1, &timerQuery);
+
+	int width = settings.imageWidth;
+	int height = settings.imageHeight;
+	int repetitions = std::max(settings.repetitions, 1);
+	bool passed = true;
+	bool missingReferences = false;
+
+	std::string results = "{\n";
+	results += fmt::format("  \"renderer\": \"{}\",\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	results += fmt::format("  \"width\": {},\n  \"height\": {},\n  \"repetitions\": {},\n", width, height, repetitions);
+	results += "  \"cases\": [\n";
+
+	std::string newBaseline = "# GPU frame times of the benchmark cases in cases.txt on the reference render node.\n"
+							  "# Written by raymarching --benchmark --update-references together with the golden images. Cases without an\n"
+							  "# entry are skipped.\n"
+							  "# name median_ms mad_ms repetitions\n";
+
+	for (size_t index = 0; index < cases.size(); index++) {
+		const BenchmarkCase& benchmarkCase = cases[index];
+
+		/*---------- Timing -----------*/
+		for (int i = 0; i < WARMUP_RENDERS; i++) {
+			drawTile(benchmarkCase.pose, width, height, 0, 0, width, height);
+		}
+		glFinish();
+
+		std::vector<double> frameMs;
+		for (int i = 0; i < repetitions; i++) {
+			glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+			drawTile(benchmarkCase.pose, width, height, 0, 0, width, height);
+			glEndQuery(GL_TIME_ELAPSED);
+
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &nanoseconds);
+			frameMs.push_back(nanoseconds / 1.0e6);
+		}
+		double medianMs = median(frameMs);
+		double madMs = medianAbsoluteDeviation(frameMs, medianMs);
+		newBaseline += fmt::format("{} {:.4f} {:.4f} {}\n", benchmarkCase.name, medianMs, madMs, repetitions);
+
+		// Regressed when the slowdown exceeds both the 99% confidence interval of the difference and the minimum tolerance
+		bool hasBaseline = baseline.count(benchmarkCase.name) > 0;
+		bool regressed = false;
+		double allowedMs = 0.0;
+		bool missingBaseline = !hasBaseline && !settings.updateReferences;
+		if (hasBaseline && !settings.updateReferences) {
+			const Baseline& reference = baseline[benchmarkCase.name];
+			double standardError = std::sqrt(std::pow(medianStandardError(madMs, repetitions), 2.0)
+										   + std::pow(medianStandardError(reference.madMs, reference.repetitions), 2.0));
+			allowedMs = std::max(2.576 * standardError, settings.minRegression * reference.medianMs);
+			regressed = medianMs - reference.medianMs > allowedMs;
+		}
+
+		/*---------- Image comparison -----------*/
+		std::vector<unsigned char> pixels;
+		renderTile(benchmarkCase.pose, width, height, 0, 0, width, height, pixels);
+		std::vector<unsigned char> image = flipRows(pixels, width, height);
+
+		std::string goldenFile = settings.goldenDirectory + "/" + benchmarkCase.name + ".png";
+		bool hasGolden = false;
+		bool imageMatches = true;
+		double meanDeltaE = 0.0;
+		double percentileDeltaE = 0.0;
+
+		if (settings.updateReferences) {
+			unsigned int error = lodepng::encode(goldenFile, image, width, height);
+			if (error) {
+				fprintf(stderr, "Could not write %s: %s\n", goldenFile.c_str(), lodepng_error_text(error));
+				passed = false;
+			}
+		} else {
+			std::vector<unsigned char> golden;
+			unsigned int goldenWidth, goldenHeight;
+			hasGolden = lodepng::decode(golden, goldenWidth, goldenHeight, goldenFile) == 0;
+			if (hasGolden && (int(goldenWidth) != width || int(goldenHeight) != height)) {
+				fprintf(stderr, "%s is %ux%u, expected %ix%i\n", goldenFile.c_str(), goldenWidth, goldenHeight, width, height);
+				imageMatches = false;
+			} else if (hasGolden) {
+				compareImages(image, golden, meanDeltaE, percentileDeltaE);
+				imageMatches = meanDeltaE <= settings.maxMeanDeltaE && percentileDeltaE <= settings.maxPercentileDeltaE;
+			} else {
+				imageMatches = false;
+			}
+		}
+		bool missingGolden = !hasGolden && !settings.updateReferences;
+
+		// A case without references has not been checked. It does not fail, but keeps the suite from passing
+		passed = passed && (imageMatches || missingGolden) && !regressed;
+		missingReferences = missingReferences || missingBaseline || missingGolden;
+		printf("%-20s %8.3f ms (MAD %.3f)%s%s%s%s%s\n", benchmarkCase.name.c_str(), medianMs, madMs,
+			hasBaseline ? fmt::format(", baseline {:.3f} ms", baseline[benchmarkCase.name].medianMs).c_str() : "",
+			regressed ? "  REGRESSED" : "",
+			missingBaseline ? "  MISSING BASELINE" : "",
+			missingGolden ? "  MISSING GOLDEN" : "",
+			(imageMatches || missingGolden) ? "" : "  IMAGE MISMATCH");
+
+		results += "    {\n";
+		results += fmt::format("      \"name\": \"{}\",\n", benchmarkCase.name);
+		results += fmt::format("      \"median_ms\": {:.4f},\n      \"mad_ms\": {:.4f},\n", medianMs, madMs);
+		results += "      \"samples_ms\": [";
+		for (size_t i = 0; i < frameMs.size(); i++) {
+			results += fmt::format("{}{:.4f}", i ? ", " : "", frameMs[i]);
+		}
+		results += "],\n";
+		if (hasBaseline) {
+			results += fmt::format("      \"baseline_median_ms\": {:.4f},\n      \"allowed_regression_ms\": {:.4f},\n", baseline[benchmarkCase.name].medianMs, allowedMs);
+		}
+		results += fmt::format("      \"has_baseline\": {},\n", hasBaseline ? "true" : "false");
+		results += fmt::format("      \"regressed\": {},\n", regressed ? "true" : "false");
+		results += fmt::format("      \"has_golden\": {},\n", hasGolden ? "true" : "false");
+		if (hasGolden) {
+			results += fmt::format("      \"mean_delta_e\": {:.4f},\n      \"p99_delta_e\": {:.4f},\n", meanDeltaE, percentileDeltaE);
+		}
+		results += fmt::format("      \"image_matches\": {}\n", imageMatches ? "true" : "false");
+		results += (index + 1 < cases.size()) ? "    },\n" : "    }\n";
+	}
+
+	results += "  ],\n";
+	results += fmt::format("  \"missing_references\": {},\n", missingReferences ? "true" : "false");
+	results += fmt::format("  \"passed\": {}\n}}\n", (passed && !missingReferences) ? "true" : "false");
+
+	glDeleteQueries(1, &timerQuery);
+
+	if (!settings.resultsFile.empty()) {
+		std::ofstream resultsFile(settings.resultsFile.c_str());
+		resultsFile << results;
+	}
+	if (settings.updateReferences) {
+		std::ofstream baselineFile(settings.baselineFile.c_str());
+		baselineFile << newBaseline;
+		printf("Updated golden images in %s and baseline %s\n", settings.goldenDirectory.c_str(), settings.baselineFile.c_str());
+	}
+
+	if (!passed) {
+		printf("Benchmark FAILED\n");
+		return EXIT_FAILURE;
+	}
+	if (missingReferences) {
+		printf("Benchmark SKIPPED, some cases have no reference. Create them with --update-references on the reference machine\n");
+		return BENCHMARK_MISSING_REFERENCES;
+	}
+	printf("Benchmark passed\n");
+	return EXIT_SUCCESS;
+}
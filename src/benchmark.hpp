@@ -0,0 +1,28 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <string>
+
+// Performance regression suite. Renders a fixed set of camera poses offscreen, compares the images
+// against golden images and the GPU frame times against a committed baseline.
+struct BenchmarkSettings {
+	std::string casesFile;			// Lines of "name time x y z yaw pitch"
+	std::string goldenDirectory;	// Golden images, one <name>.png per case
+	std::string baselineFile;		// Lines of "name median_ms mad_ms repetitions"
+	std::string resultsFile;		// Machine readable results (JSON)
+	int imageWidth;
+	int imageHeight;
+	int repetitions;				// Timed renders per case, after a few warm-up renders
+	float maxMeanDeltaE;			// Largest allowed mean colour difference (CIE76) against the golden image
+	float maxPercentileDeltaE;		// Largest allowed 99th percentile colour difference
+	float minRegression;			// Relative slowdown that is always tolerated, on top of the confidence interval
+	bool updateReferences;			// Write new golden images and baseline instead of comparing
+};
+
+// Exit code when nothing failed but some cases have no golden image or baseline entry, so they were not checked.
+// CTest reports the test as skipped (SKIP_RETURN_CODE)
+const int BENCHMARK_MISSING_REFERENCES = 77;
+
+// Returns EXIT_SUCCESS when every case matches its golden image and did not regress, EXIT_FAILURE when one failed,
+// and BENCHMARK_MISSING_REFERENCES otherwise
+int runBenchmark(GLFWwindow* window, const BenchmarkSettings& settings);
@@ -0,0 +1,447 @@
+#include "coordinator.hpp"
+#include "protocol.hpp"
+
+#include <glm/glm.hpp>
+#include <lodepng.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace Farm {
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct PathKey {
+		float time;
+		glm::vec3 position;
+		float yaw;
+		float pitch;
+	};
+
+	struct Job {
+		JobMessage message;
+		int attempts = 0;			// Times the job was lost together with its worker
+		int runningOn = 0;			// Workers currently rendering the job (more than one after stealing)
+		bool done = false;
+	};
+
+	struct JobInFlight {
+		uint32_t jobID;
+		Clock::time_point started;
+	};
+
+	struct Worker {
+		int socket;
+		MessageReader reader;
+		uint32_t maxJobsInFlight = 0;		// Zero until the worker said hello
+		std::vector<JobInFlight> jobsInFlight;
+		bool connected = true;
+	};
+
+	struct Frame {
+		std::vector<unsigned char> pixels;	// RGBA8, bottom row first like glReadPixels
+		unsigned int tilesRemaining = 0;
+	};
+
+	// Reads camera keyframes. Lines starting with '#' are comments
+	static bool loadCameraPath(const std::string& filename, std::vector<PathKey>& keys) {
+		std::ifstream file(filename.c_str());
+		if (file.fail()) {
+			fprintf(stderr, "Could not open camera path \"%s\"\n", filename.c_str());
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(file, line)) {
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+			std::istringstream values(line);
+			PathKey key;
+			if (values >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch) {
+				keys.push_back(key);
+			}
+		}
+		std::sort(keys.begin(), keys.end(), [](const PathKey& a, const PathKey& b) { return a.time < b.time; });
+		return !keys.empty();
+	}
+
+	// Linear interpolation between the keys surrounding the given time
+	static PathKey sampleCameraPath(const std::vector<PathKey>& keys, float time) {
+		if (time <= keys.front().time) return keys.front();
+		if (time >= keys.back().time) return keys.back();
+
+		size_t next = 1;
+		while (keys[next].time < time) next++;
+		const PathKey& a = keys[next - 1];
+		const PathKey& b = keys[next];
+		float t = (time - a.time) / std::max(b.time - a.time, 1e-6f);
+
+		PathKey key;
+		key.time = time;
+		key.position = glm::mix(a.position, b.position, t);
+		key.yaw = glm::mix(a.yaw, b.yaw, t);
+		key.pitch = glm::mix(a.pitch, b.pitch, t);
+		return key;
+	}
+
+	static bool writeFrame(const CoordinatorSettings& settings, unsigned int frameIndex, const Frame& frame) {
+		// Flip to top row first for the image file
+		size_t rowSize = size_t(settings.imageWidth) * 4;
+		std::vector<unsigned char> image(frame.pixels.size());
+		for (int row = 0; row < settings.imageHeight; row++) {
+			std::memcpy(&image[row * rowSize], &frame.pixels[(settings.imageHeight - 1 - row) * rowSize], rowSize);
+		}
+
+		std::string filename = fmt::format("{}/frame_{:05d}.png", settings.outputDirectory, frameIndex);
+		unsigned int error = lodepng::encode(filename, image, settings.imageWidth, settings.imageHeight);
+		if (error) {
+			fprintf(stderr, "Could not write %s: %s\n", filename.c_str(), lodepng_error_text(error));
+			return false;
+		}
+		return true;
+	}
+
+	// Starts a worker process running this executable
+	static pid_t spawnLocalWorker(const std::string& address) {
+		pid_t pid = fork();
+		if (pid == 0) {
+			std::string argument = "--worker=" + address;
+			execl("/proc/self/exe", "raymarching", argument.c_str(), (char*)nullptr);
+			fprintf(stderr, "Could not start worker process (%s)\n", strerror(errno));
+			_exit(EXIT_FAILURE);
+		}
+		return pid;
+	}
+
+	int runCoordinator(const CoordinatorSettings& settings) {
+		if (settings.imageWidth <= 0 || settings.imageHeight <= 0 || settings.tileSize <= 0 || settings.framesPerSecond <= 0.0f) {
+			fprintf(stderr, "Image size, tile size and frame rate must be positive\n");
+			return EXIT_FAILURE;
+		}
+
+		std::vector<PathKey> cameraPath;
+		if (settings.cameraPath.empty()) {
+			cameraPath.push_back({ 0.0f, glm::vec3(0.0f, 0.0f, -5.0f), 0.0f, 0.0f });
+		} else if (!loadCameraPath(settings.cameraPath, cameraPath)) {
+			return EXIT_FAILURE;
+		}
+
+		/*---------- Split the sequence into tile jobs -----------*/
+		unsigned int frameCount = unsigned(std::max(0.0f, (settings.endTime - settings.startTime) * settings.framesPerSecond)) + 1;
+		unsigned int tilesX = (settings.imageWidth + settings.tileSize - 1) / settings.tileSize;
+		unsigned int tilesY = (settings.imageHeight + settings.tileSize - 1) / settings.tileSize;
+
+		std::vector<Job> jobs;
+		std::vector<Frame> frames(frameCount);
+		std::deque<uint32_t> pendingJobs;
+
+		for (unsigned int frame = 0; frame < frameCount; frame++) {
+			float time = settings.startTime + frame / settings.framesPerSecond;
+			PathKey pose = sampleCameraPath(cameraPath, time);
+			frames[frame].tilesRemaining = tilesX * tilesY;
+
+			for (unsigned int tileY = 0; tileY < tilesY; tileY++) {
+				for (unsigned int tileX = 0; tileX < tilesX; tileX++) {
+					Job job;
+					JobMessage& message = job.message;
+					message.jobID = uint32_t(jobs.size());
+					message.frame = frame;
+					message.imageWidth = settings.imageWidth;
+					message.imageHeight = settings.imageHeight;
+					message.tileX = tileX * settings.tileSize;
+					message.tileY = tileY * settings.tileSize;
+					message.tileWidth = std::min<uint32_t>(settings.tileSize, settings.imageWidth - message.tileX);
+					message.tileHeight = std::min<uint32_t>(settings.tileSize, settings.imageHeight - message.tileY);
+					message.time = time;
+					message.position[0] = pose.position.x;
+					message.position[1] = pose.position.y;
+					message.position[2] = pose.position.z;
+					message.yaw = pose.yaw;
+					message.pitch = pose.pitch;
+
+					pendingJobs.push_back(message.jobID);
+					jobs.push_back(job);
+				}
+			}
+		}
+
+		mkdir(settings.outputDirectory.c_str(), 0755);
+
+		/*---------- Start listening and spawn local workers -----------*/
+		int listenSocket = listenOn(settings.address);
+		if (listenSocket < 0) {
+			return EXIT_FAILURE;
+		}
+
+		std::vector<pid_t> children;
+		for (int i = 0; i < settings.localWorkers; i++) {
+			children.push_back(spawnLocalWorker(settings.address));
+		}
+
+		printf("Rendering %u frames of %ix%i as %zu tile jobs\n", frameCount, settings.imageWidth, settings.imageHeight, jobs.size());
+
+		std::vector<Worker> workers;
+		unsigned int firstUnwrittenFrame = 0;
+		double totalJobSeconds = 0.0;
+		unsigned int finishedJobs = 0;
+		bool failed = false;
+		Clock::time_point startTime = Clock::now();
+
+		MessageHeader header;
+		std::vector<char> payload;
+
+		// Puts the jobs of a lost worker back in the queue
+		auto dropWorker = [&](Worker& worker) {
+			worker.connected = false;
+			closeSocket(worker.socket);
+			for (const JobInFlight& inFlight : worker.jobsInFlight) {
+				Job& job = jobs[inFlight.jobID];
+				job.runningOn--;
+				if (job.done || job.runningOn > 0) {
+					continue;
+				}
+				if (++job.attempts > settings.maxRetries) {
+					fprintf(stderr, "Job %u (frame %u) failed %i times, giving up\n", inFlight.jobID, job.message.frame, job.attempts);
+					failed = true;
+				}
+				pendingJobs.push_front(inFlight.jobID);
+			}
+			worker.jobsInFlight.clear();
+			fprintf(stderr, "Lost a worker, re-queued its jobs\n");
+		};
+
+		auto sendJob = [&](Worker& worker, uint32_t jobID) {
+			if (!sendMessage(worker.socket, MESSAGE_JOB, &jobs[jobID].message, sizeof(JobMessage))) {
+				return false;
+			}
+			jobs[jobID].runningOn++;
+			worker.jobsInFlight.push_back({ jobID, Clock::now() });
+			return true;
+		};
+
+		auto handleTile = [&](Worker& worker) {
+			if (payload.size() < sizeof(TileMessage)) {
+				return false;
+			}
+			TileMessage tile;
+			std::memcpy(&tile, payload.data(), sizeof(TileMessage));
+			if (tile.jobID >= jobs.size()) {
+				return false;
+			}
+
+			auto inFlight = std::find_if(worker.jobsInFlight.begin(), worker.jobsInFlight.end(),
+				[&](const JobInFlight& entry) { return entry.jobID == tile.jobID; });
+			if (inFlight == worker.jobsInFlight.end()) {
+				return false;
+			}
+
+			// A malformed tile drops the worker, which re-queues the job only while it is still in flight there
+			Job& job = jobs[tile.jobID];
+			const JobMessage& message = job.message;
+			size_t rowSize = size_t(message.tileWidth) * 4;
+			if (tile.tileWidth != message.tileWidth || tile.tileHeight != message.tileHeight
+				|| payload.size() != sizeof(TileMessage) + rowSize * message.tileHeight) {
+				return false;
+			}
+
+			double seconds = std::chrono::duration<double>(Clock::now() - inFlight->started).count();
+			worker.jobsInFlight.erase(inFlight);
+			job.runningOn--;
+			if (job.done) {
+				return true;		// A stolen duplicate finished first
+			}
+
+			Frame& frame = frames[message.frame];
+			if (frame.pixels.empty()) {
+				frame.pixels.resize(size_t(settings.imageWidth) * settings.imageHeight * 4);
+			}
+			const char* source = payload.data() + sizeof(TileMessage);
+			for (uint32_t row = 0; row < message.tileHeight; row++) {
+				size_t offset = ((size_t(message.tileY) + row) * settings.imageWidth + message.tileX) * 4;
+				std::memcpy(&frame.pixels[offset], source + row * rowSize, rowSize);
+			}
+
+			job.done = true;
+			frame.tilesRemaining--;
+			totalJobSeconds += seconds;
+			finishedJobs++;
+			return true;
+		};
+
+		/*---------- Main loop -----------*/
+		while (firstUnwrittenFrame < frameCount && !failed) {
+			std::vector<pollfd> pollDescriptors;
+			pollDescriptors.push_back({ listenSocket, POLLIN, 0 });
+			for (Worker& worker : workers) {
+				pollDescriptors.push_back({ worker.connected ? worker.socket : -1, POLLIN, 0 });
+			}
+
+			// Wake up regularly to look for stragglers even when no messages arrive
+			if (poll(pollDescriptors.data(), pollDescriptors.size(), 100) < 0 && errno != EINTR) {
+				fprintf(stderr, "poll failed (%s)\n", strerror(errno));
+				failed = true;
+				break;
+			}
+
+			if (pollDescriptors[0].revents & POLLIN) {
+				int socket = acceptConnection(listenSocket);
+				if (socket >= 0) {
+					workers.emplace_back();
+					workers.back().socket = socket;
+				}
+			}
+
+			for (size_t i = 0; i + 1 < pollDescriptors.size(); i++) {
+				Worker& worker = workers[i];
+				if (!worker.connected || pollDescriptors[i + 1].revents == 0) {
+					continue;
+				}
+
+				// Handle every complete message first, the worker may have sent its last tile right before closing
+				bool open = worker.reader.readAvailable(worker.socket);
+				bool valid = true;
+				while (valid && worker.reader.nextMessage(header, payload)) {
+					if (header.type == MESSAGE_HELLO && payload.size() == sizeof(HelloMessage)) {
+						HelloMessage hello;
+						std::memcpy(&hello, payload.data(), sizeof(HelloMessage));
+						worker.maxJobsInFlight = std::max<uint32_t>(hello.maxJobsInFlight, 1);
+					} else if (header.type == MESSAGE_TILE) {
+						valid = handleTile(worker);
+					} else {
+						valid = false;
+					}
+				}
+				if (!open || !valid) {
+					dropWorker(worker);
+				}
+			}
+
+			// Write out finished frames in order and release their memory
+			while (firstUnwrittenFrame < frameCount && frames[firstUnwrittenFrame].tilesRemaining == 0) {
+				Frame& frame = frames[firstUnwrittenFrame];
+				if (!writeFrame(settings, firstUnwrittenFrame, frame)) {
+					failed = true;
+				}
+				std::vector<unsigned char>().swap(frame.pixels);
+				firstUnwrittenFrame++;
+				printf("Frame %u/%u done\n", firstUnwrittenFrame, frameCount);
+			}
+
+			// Hand out queued jobs, but never run ahead of the oldest unwritten frame by more than framesInFlight
+			for (Worker& worker : workers) {
+				while (worker.connected && worker.jobsInFlight.size() < worker.maxJobsInFlight && !pendingJobs.empty()) {
+					uint32_t jobID = pendingJobs.front();
+					if (jobs[jobID].done) {
+						pendingJobs.pop_front();
+						continue;
+					}
+					if (jobs[jobID].message.frame >= firstUnwrittenFrame + settings.framesInFlight) {
+						break;
+					}
+					pendingJobs.pop_front();
+					if (!sendJob(worker, jobID)) {
+						pendingJobs.push_front(jobID);
+						dropWorker(worker);
+					}
+				}
+			}
+
+			// Work stealing: idle workers duplicate the longest running job that is well behind the average. A worker
+			// is only idle here when the queue is empty or the framesInFlight window blocks it, e.g. behind a slow or
+			// hung tile of the oldest frame
+			if (finishedJobs > 0) {
+				double averageSeconds = totalJobSeconds / finishedJobs;
+				Clock::time_point now = Clock::now();
+
+				for (Worker& thief : workers) {
+					if (!thief.connected || thief.maxJobsInFlight == 0 || !thief.jobsInFlight.empty()) {
+						continue;
+					}
+
+					uint32_t straggler = uint32_t(jobs.size());
+					double longestSeconds = averageSeconds * settings.stealFactor;
+					for (const Worker& victim : workers) {
+						for (const JobInFlight& inFlight : victim.jobsInFlight) {
+							double seconds = std::chrono::duration<double>(now - inFlight.started).count();
+							const Job& job = jobs[inFlight.jobID];
+							if (!job.done && job.runningOn == 1 && seconds > longestSeconds) {
+								straggler = inFlight.jobID;
+								longestSeconds = seconds;
+							}
+						}
+					}
+					if (straggler < jobs.size() && !sendJob(thief, straggler)) {
+						dropWorker(thief);
+					}
+				}
+			}
+
+			// Reap local workers that exited on their own
+			for (pid_t& child : children) {
+				if (child > 0 && waitpid(child, nullptr, WNOHANG) == child) {
+					child = 0;
+				}
+			}
+			bool anyConnected = std::any_of(workers.begin(), workers.end(), [](const Worker& worker) { return worker.connected; });
+			bool anyChildAlive = std::any_of(children.begin(), children.end(), [](pid_t child) { return child > 0; });
+			if (settings.localWorkers > 0 && !anyConnected && !anyChildAlive) {
+				fprintf(stderr, "All local workers exited before the sequence was finished\n");
+				failed = true;
+			}
+		}
+
+		/*---------- Shut down -----------*/
+		for (Worker& worker : workers) {
+			if (worker.connected) {
+				sendMessage(worker.socket, MESSAGE_SHUTDOWN, nullptr, 0);
+				closeSocket(worker.socket);
+			}
+		}
+		closeSocket(listenSocket);
+		if (settings.address.compare(0, 4, "tcp:") != 0) {
+			unlink(settings.address.compare(0, 5, "unix:") == 0 ? settings.address.substr(5).c_str() : settings.address.c_str());
+		}
+
+		for (pid_t child : children) {
+			if (child > 0) {
+				if (failed) {
+					kill(child, SIGTERM);
+				}
+				waitpid(child, nullptr, 0);
+			}
+		}
+
+		double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+		printf("Rendered %u/%u frames in %.2f s (%.2f frames/s)\n", firstUnwrittenFrame, frameCount, seconds, firstUnwrittenFrame / seconds);
+		return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+}
+
+#else
+
+namespace Farm {
+
+	int runCoordinator(const CoordinatorSettings& settings) {
+		fprintf(stderr, "The render farm is only supported on Linux and other POSIX systems.\n");
+		return EXIT_FAILURE;
+	}
+}
+
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+namespace Farm {
+
+	struct CoordinatorSettings {
+		std::string address;		// Socket the coordinator listens on, see protocol.hpp
+		int localWorkers;			// Workers spawned on this machine. Remote workers may connect as well
+		std::string cameraPath;		// File with lines of "time x y z yaw pitch". Empty for a still camera
+		float startTime;
+		float endTime;
+		float framesPerSecond;
+		int imageWidth;
+		int imageHeight;
+		int tileSize;
+		int framesInFlight;			// Frames that may be partially rendered at once. Bounds coordinator memory
+		int maxRetries;				// Times a job is re-queued after its worker was lost
+		float stealFactor;			// A job running this many times longer than the average is duplicated to an idle worker
+		std::string outputDirectory;
+	};
+
+	// Splits the sequence into tile jobs, distributes them over the workers and writes finished frames as PNG files.
+	// Returns EXIT_SUCCESS when every frame was written
+	int runCoordinator(const CoordinatorSettings& settings);
+}
@@ -0,0 +1,312 @@
+#include "protocol.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Farm {
+
+	// Splits "tcp:<host>:<port>" into host and port. Returns false for unix socket addresses
+	static bool parseTcpAddress(const std::string& address, std::string& host, std::string& port) {
+		if (address.compare(0, 4, "tcp:") != 0) {
+			return false;
+		}
+		size_t separator = address.rfind(':');
+		host = address.substr(4, separator - 4);
+		port = address.substr(separator + 1);
+		return true;
+	}
+
+	static std::string unixPath(const std::string& address) {
+		return (address.compare(0, 5, "unix:") == 0) ? address.substr(5) : address;
+	}
+
+	static bool fillUnixAddress(const std::string& path, sockaddr_un& socketAddress) {
+		std::memset(&socketAddress, 0, sizeof(socketAddress));
+		socketAddress.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(socketAddress.sun_path)) {
+			fprintf(stderr, "Socket path is too long: %s\n", path.c_str());
+			return false;
+		}
+		std::strcpy(socketAddress.sun_path, path.c_str());
+		return true;
+	}
+
+	// Resolves a tcp address and either binds or connects to the first candidate that works
+	static int openTcpSocket(const std::string& host, const std::string& port, bool listening) {
+		addrinfo hints;
+		std::memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = listening ? AI_PASSIVE : 0;
+
+		addrinfo* candidates;
+		int error = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &candidates);
+		if (error != 0) {
+			fprintf(stderr, "Could not resolve %s:%s (%s)\n", host.c_str(), port.c_str(), gai_strerror(error));
+			return -1;
+		}
+
+		int result = -1;
+		for (addrinfo* candidate = candidates; candidate != nullptr && result < 0; candidate = candidate->ai_next) {
+			int fd = socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+			if (fd < 0) {
+				continue;
+			}
+			if (listening) {
+				int reuse = 1;
+				setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+				if (bind(fd, candidate->ai_addr, candidate->ai_addrlen) == 0 && listen(fd, 64) == 0) {
+					result = fd;
+				}
+			} else if (connect(fd, candidate->ai_addr, candidate->ai_addrlen) == 0) {
+				result = fd;
+			}
+			if (result < 0) {
+				close(fd);
+			}
+		}
+		freeaddrinfo(candidates);
+
+		if (result < 0) {
+			fprintf(stderr, "Could not %s tcp:%s:%s (%s)\n", listening ? "listen on" : "connect to", host.c_str(), port.c_str(), strerror(errno));
+		}
+		return result;
+	}
+
+	int listenOn(const std::string& address) {
+		std::string host, port;
+		if (parseTcpAddress(address, host, port)) {
+			return openTcpSocket(host, port, true);
+		}
+
+		sockaddr_un socketAddress;
+		std::string path = unixPath(address);
+		if (!fillUnixAddress(path, socketAddress)) {
+			return -1;
+		}
+
+		// Remove a stale socket left behind by a previous run
+		unlink(path.c_str());
+
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0 || bind(fd, (sockaddr*)&socketAddress, sizeof(socketAddress)) != 0 || listen(fd, 64) != 0) {
+			fprintf(stderr, "Could not listen on %s (%s)\n", path.c_str(), strerror(errno));
+			if (fd >= 0) {
+				close(fd);
+			}
+			return -1;
+		}
+		return fd;
+	}
+
+	int connectTo(const std::string& address) {
+		std::string host, port;
+		if (parseTcpAddress(address, host, port)) {
+			return openTcpSocket(host, port, false);
+		}
+
+		sockaddr_un socketAddress;
+		std::string path = unixPath(address);
+		if (!fillUnixAddress(path, socketAddress)) {
+			return -1;
+		}
+
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0 || connect(fd, (sockaddr*)&socketAddress, sizeof(socketAddress)) != 0) {
+			fprintf(stderr, "Could not connect to %s (%s)\n", path.c_str(), strerror(errno));
+			if (fd >= 0) {
+				close(fd);
+			}
+			return -1;
+		}
+		return fd;
+	}
+
+	int acceptConnection(int listenSocket) {
+		return accept(listenSocket, nullptr, nullptr);
+	}
+
+	void closeSocket(int socket) {
+		close(socket);
+	}
+
+	// Writes all buffers, retrying on partial writes. MSG_NOSIGNAL keeps a lost peer from raising SIGPIPE
+	static bool sendAll(int socket, iovec* buffers, int bufferCount) {
+		while (bufferCount > 0) {
+			msghdr message;
+			std::memset(&message, 0, sizeof(message));
+			message.msg_iov = buffers;
+			message.msg_iovlen = bufferCount;
+
+			ssize_t sent = sendmsg(socket, &message, MSG_NOSIGNAL);
+			if (sent < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+
+			// Skip past everything that was written
+			while (bufferCount > 0 && size_t(sent) >= buffers->iov_len) {
+				sent -= buffers->iov_len;
+				buffers++;
+				bufferCount--;
+			}
+			if (bufferCount > 0) {
+				buffers->iov_base = (char*)buffers->iov_base + sent;
+				buffers->iov_len -= sent;
+			}
+		}
+		return true;
+	}
+
+	bool sendMessage(int socket, MessageType type, const void* header, size_t headerSize, const void* data, size_t dataSize) {
+		MessageHeader messageHeader = { type, uint32_t(headerSize + dataSize) };
+		iovec buffers[3] = {
+			{ &messageHeader, sizeof(messageHeader) },
+			{ const_cast<void*>(header), headerSize },
+			{ const_cast<void*>(data), dataSize }
+		};
+		return sendAll(socket, buffers, 3);
+	}
+
+	bool sendMessage(int socket, MessageType type, const void* payload, size_t size) {
+		return sendMessage(socket, type, payload, size, nullptr, 0);
+	}
+
+	static bool receiveAll(int socket, void* data, size_t size) {
+		char* cursor = (char*)data;
+		while (size > 0) {
+			ssize_t received = recv(socket, cursor, size, 0);
+			if (received < 0 && errno == EINTR) {
+				continue;
+			}
+			if (received <= 0) {
+				return false;
+			}
+			cursor += received;
+			size -= received;
+		}
+		return true;
+	}
+
+	bool receiveMessage(int socket, MessageHeader& header, std::vector<char>& payload) {
+		if (!receiveAll(socket, &header, sizeof(header)) || header.size > MAX_PAYLOAD_SIZE) {
+			return false;
+		}
+		payload.resize(header.size);
+		return receiveAll(socket, payload.data(), header.size);
+	}
+
+	bool MessageReader::readAvailable(int socket) {
+		char chunk[64 * 1024];
+		while (true) {
+			ssize_t received = recv(socket, chunk, sizeof(chunk), MSG_DONTWAIT);
+			if (received > 0) {
+				buffer.insert(buffer.end(), chunk, chunk + received);
+				if (hasOversizedMessage()) {
+					return false;	// Stop buffering a payload that would never be accepted
+				}
+				continue;
+			}
+			if (received < 0 && errno == EINTR) {
+				continue;
+			}
+			if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+				return true;
+			}
+			return false;	// Orderly shutdown or error
+		}
+	}
+
+	bool MessageReader::hasOversizedMessage() const {
+		if (buffer.size() - readOffset < sizeof(MessageHeader)) {
+			return false;
+		}
+		MessageHeader header;
+		std::memcpy(&header, buffer.data() + readOffset, sizeof(MessageHeader));
+		return header.size > MAX_PAYLOAD_SIZE;
+	}
+
+	bool MessageReader::nextMessage(MessageHeader& header, std::vector<char>& payload) {
+		size_t available = buffer.size() - readOffset;
+		if (available < sizeof(MessageHeader)) {
+			return false;
+		}
+		std::memcpy(&header, buffer.data() + readOffset, sizeof(MessageHeader));
+		if (header.size > MAX_PAYLOAD_SIZE) {
+			return false;
+		}
+		if (available < sizeof(MessageHeader) + header.size) {
+			return false;
+		}
+
+		const char* data = buffer.data() + readOffset + sizeof(MessageHeader);
+		payload.assign(data, data + header.size);
+		readOffset += sizeof(MessageHeader) + header.size;
+
+		// Compact once everything buffered has been consumed, or the consumed part dominates
+		if (readOffset == buffer.size()) {
+			buffer.clear();
+			readOffset = 0;
+		} else if (readOffset > buffer.size() / 2) {
+			buffer.erase(buffer.begin(), buffer.begin() + readOffset);
+			readOffset = 0;
+		}
+		return true;
+	}
+}
+
+#else
+
+namespace Farm {
+
+	int listenOn(const std::string& address) {
+		fprintf(stderr, "The render farm is only supported on Linux and other POSIX systems.\n");
+		return -1;
+	}
+
+	int connectTo(const std::string& address) {
+		return listenOn(address);
+	}
+
+	int acceptConnection(int listenSocket) {
+		return -1;
+	}
+
+	void closeSocket(int socket) {}
+
+	bool sendMessage(int socket, MessageType type, const void* header, size_t headerSize, const void* data, size_t dataSize) {
+		return false;
+	}
+
+	bool sendMessage(int socket, MessageType type, const void* payload, size_t size) {
+		return false;
+	}
+
+	bool receiveMessage(int socket, MessageHeader& header, std::vector<char>& payload) {
+		return false;
+	}
+
+	bool MessageReader::readAvailable(int socket) {
+		return false;
+	}
+
+	bool MessageReader::nextMessage(MessageHeader& header, std::vector<char>& payload) {
+		return false;
+	}
+
+	bool MessageReader::hasOversizedMessage() const {
+		return false;
+	}
+}
+
+#endif
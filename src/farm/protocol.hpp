@@ -0,0 +1,86 @@
+#pragma once
+
+// Message protocol between the render farm coordinator and its workers.
+//
+// Every message is a MessageHeader followed by `size` bytes of payload. Payloads are
+// plain structs in native byte order, so the coordinator and workers must run on the same
+// architecture. Addresses are either "unix:<path>" (the default when no prefix is given)
+// or "tcp:<host>:<port>" for workers on other machines.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Farm {
+
+	enum MessageType : uint32_t {
+		MESSAGE_HELLO = 1,		// Worker -> coordinator, HelloMessage
+		MESSAGE_JOB,			// Coordinator -> worker, JobMessage
+		MESSAGE_TILE,			// Worker -> coordinator, TileMessage followed by RGBA8 pixels
+		MESSAGE_SHUTDOWN		// Coordinator -> worker, no payload
+	};
+
+	struct MessageHeader {
+		uint32_t type;
+		uint32_t size;
+	};
+
+	struct HelloMessage {
+		uint32_t maxJobsInFlight;	// Jobs the coordinator may queue on this worker (back-pressure window)
+	};
+
+	struct JobMessage {
+		uint32_t jobID;
+		uint32_t frame;
+		uint32_t imageWidth;
+		uint32_t imageHeight;
+		// Tile rectangle in OpenGL window coordinates (origin in the lower left corner)
+		uint32_t tileX;
+		uint32_t tileY;
+		uint32_t tileWidth;
+		uint32_t tileHeight;
+		// Camera pose and animation time
+		float time;
+		float position[3];
+		float yaw;
+		float pitch;
+	};
+
+	struct TileMessage {
+		uint32_t jobID;
+		uint32_t tileWidth;
+		uint32_t tileHeight;
+	};
+
+	// Upper bound on payload sizes, guards against corrupt headers
+	const uint32_t MAX_PAYLOAD_SIZE = 256u * 1024u * 1024u;
+
+	// Socket setup. Both return -1 and print an error on failure
+	int listenOn(const std::string& address);
+	int connectTo(const std::string& address);
+	int acceptConnection(int listenSocket);
+	void closeSocket(int socket);
+
+	// Blocking sends and receives. Return false when the connection is lost
+	bool sendMessage(int socket, MessageType type, const void* payload, size_t size);
+	bool sendMessage(int socket, MessageType type, const void* header, size_t headerSize, const void* data, size_t dataSize);
+	bool receiveMessage(int socket, MessageHeader& header, std::vector<char>& payload);
+
+	// Buffers partial reads from a non-blocking socket until whole messages have arrived
+	class MessageReader {
+	public:
+		// Reads whatever is available. Returns false when the peer disconnected or sent garbage, including a message
+		// larger than MAX_PAYLOAD_SIZE
+		bool readAvailable(int socket);
+
+		// Pops the next complete message, if any. Never returns a message larger than MAX_PAYLOAD_SIZE
+		bool nextMessage(MessageHeader& header, std::vector<char>& payload);
+
+	private:
+		// Whether the next buffered message header announces more than MAX_PAYLOAD_SIZE
+		bool hasOversizedMessage() const;
+
+		std::vector<char> buffer;
+		size_t readOffset = 0;
+	};
+}
@@ -0,0 +1,63 @@
+#include "worker.hpp"
+#include "protocol.hpp"
+#include "gamelogic.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace Farm {
+
+	// One job is rendered while the next one waits in the socket, so the GPU never idles on a round trip
+	const uint32_t JOBS_IN_FLIGHT = 2;
+
+	int runWorker(GLFWwindow* window, const std::string& address) {
+		int socket = connectTo(address);
+		if (socket < 0) {
+			return EXIT_FAILURE;
+		}
+
+		initGame(window);
+
+		HelloMessage hello = { JOBS_IN_FLIGHT };
+		if (!sendMessage(socket, MESSAGE_HELLO, &hello, sizeof(hello))) {
+			closeSocket(socket);
+			return EXIT_FAILURE;
+		}
+
+		MessageHeader header;
+		std::vector<char> payload;
+		std::vector<unsigned char> pixels;
+
+		// Sends are blocking, so a coordinator that falls behind on reading tiles stalls the worker
+		while (receiveMessage(socket, header, payload)) {
+			if (header.type == MESSAGE_SHUTDOWN) {
+				closeSocket(socket);
+				return EXIT_SUCCESS;
+			}
+			if (header.type != MESSAGE_JOB || payload.size() != sizeof(JobMessage)) {
+				fprintf(stderr, "Worker received an unexpected message (%u)\n", header.type);
+				break;
+			}
+
+			JobMessage job;
+			std::memcpy(&job, payload.data(), sizeof(JobMessage));
+
+			CameraPose pose;
+			pose.time = job.time;
+			pose.position = glm::vec3(job.position[0], job.position[1], job.position[2]);
+			pose.yaw = job.yaw;
+			pose.pitch = job.pitch;
+			renderTile(pose, job.imageWidth, job.imageHeight, job.tileX, job.tileY, job.tileWidth, job.tileHeight, pixels);
+
+			TileMessage tile = { job.jobID, job.tileWidth, job.tileHeight };
+			if (!sendMessage(socket, MESSAGE_TILE, &tile, sizeof(tile), pixels.data(), pixels.size())) {
+				break;
+			}
+		}
+
+		closeSocket(socket);
+		return EXIT_FAILURE;
+	}
+}
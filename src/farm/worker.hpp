@@ -0,0 +1,11 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <string>
+
+namespace Farm {
+
+	// Connects to the coordinator at the given address and renders the tile jobs it sends with the
+	// offscreen renderer until it is told to shut down. The window only provides the OpenGL context
+	int runWorker(GLFWwindow* window, const std::string& address);
+}
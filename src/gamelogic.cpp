@@ -4,6 +4,8 @@
 #include <utilities/shader.hpp>
 #include <glm/vec3.hpp>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <utilities/timeutils.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -12,7 +14,10 @@
 #include <algorithm>    // std::max
 #include "gamelogic.h"
 #include "sceneGraph.hpp"
+#include "animation.hpp"
+#include "pruning/tilePruning.hpp"
 #include "utilities/camera.hpp"
+#include "utilities/framebuffer.hpp"
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/transform.hpp>
 
@@ -21,6 +26,59 @@
 Gloom::Shader* shader;
 Gloom::Shader* depthShader;
 Gloom::Shader* shader2D;
+Gloom::Shader* presentShader;
+Gloom::Framebuffer* offscreenTarget = nullptr;
+
+// The last raymarched frame. It is shown again as long as nothing that affects the image changed
+Gloom::Framebuffer* frameCache = nullptr;
+int frameCacheWidth = 0;
+int frameCacheHeight = 0;
+bool sceneDirty = true;			// The cached frame is out of date and has to be raymarched again
+bool presentNeeded = true;		// The cached frame has to be shown again, e.g. after the window was uncovered
+
+// Checkerboard rendering: every frame traces half of the pixels at half width, and the reconstruction pass fills in
+// the rest from the previous frame. The reconstructed frames ping-pong between two history targets
+bool checkerboardEnabled = false;
+int checkerboardPhase = 0;
+Gloom::Shader* reconstructShader;
+Gloom::Framebuffer* traceTarget = nullptr;
+Gloom::Framebuffer* historyTargets[2] = { nullptr, nullptr };
+int historyIndex = 0;
+bool historyValid = false;
+bool convergencePending = false;	// One more frame has to be traced to fill in the half of the pixels the last frame skipped
+ViewTransform previousView;
+
+// Reflections of the objects in the sea, marched at a fraction of the image resolution before the main pass
+Gloom::Framebuffer* reflectionTarget = nullptr;
+int reflectionWidth = 0;
+int reflectionHeight = 0;
+
+// Parts of the scene primary rays can hit, per screen tile, found with interval arithmetic on the CPU
+const int PRUNE_TILE_SIZE = 16;
+unsigned int tilePartsTexture = 0;
+std::vector<unsigned char> tileParts;
+
+// Views, image size and pixel region the current masks were found for. They are only recomputed when these change
+ViewTransform prunedViews[MAX_VIEWS];
+unsigned int prunedNumViews = 0;
+int prunedWidth = 0;
+int prunedHeight = 0;
+glm::ivec4 prunedRegion(0);		// x, y, width, height
+
+// Sea heightfield shared by all views, baked around the main camera once per frame. Must match SEA_CASCADES and
+// SEA_HEIGHTFIELD_SIZE in simple.frag
+const int SEA_CASCADES = 4;
+const int SEA_HEIGHTFIELD_SIZE = 1024;
+unsigned int seaHeightfield = 0;		// 2D array texture, one layer per cascade
+Gloom::Framebuffer* seaBakeTarget = nullptr;
+float frameTime = 0.0f;					// Animation time of the frame state last applied
+
+// Time, camera, image height and quality tier the heightfield was baked for. It is only baked again when these change
+bool seaBaked = false;
+float bakedSeaTime = 0.0f;
+glm::vec3 bakedSeaCamera(0.0f);
+int bakedSeaImageHeight = 0;
+QualityTier bakedSeaTier = QUALITY_HIGH;
 
 Gloom::Camera camera(glm::vec3(0.0f, 0.0f, -5.0f));
 
@@ -43,8 +101,6 @@ double mouseSensitivity = 1.0;
 double lastMouseX = windowWidth / 2;
 double lastMouseY = windowHeight / 2;
 
-std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
-
 static int frames = 0;
 
 void mouseCallback(GLFWwindow* window, double x, double y)
@@ -61,13 +117,101 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mode)
 {
 	camera.handleKeyboardInputs(key, action);
+
+	// Number keys 1-3 select the low, medium and high quality tier
+	if (action == GLFW_PRESS && key >= GLFW_KEY_1 && key <= GLFW_KEY_3) {
+		setQualityTier(QualityTier(key - GLFW_KEY_1));
+	}
+
+	// P pauses the sea and all other animation
+	if (action == GLFW_PRESS && key == GLFW_KEY_P) {
+		isPaused = !isPaused;
+	}
+
+	// C toggles checkerboard rendering
+	if (action == GLFW_PRESS && key == GLFW_KEY_C) {
+		setCheckerboardRendering(!checkerboardEnabled);
+	}
+}
+
+void framebufferSizeCallback(GLFWwindow*, int, int)
+{
+	sceneDirty = true;
+}
+
+void windowRefreshCallback(GLFWwindow*)
+{
+	presentNeeded = true;
 }
 
 unsigned int const  numLights = 1;
 LightSource lightSources[numLights];
 
+// Soft shadow volumes. A volume is invalidated when its light moves and rebuilt once the light is at rest again,
+// so animated lights keep marching their shadows instead of rebuilding a volume every frame
+ShadowCache shadowCaches[numLights];
+Gloom::Framebuffer* shadowVolumeTarget = nullptr;
+
+// View rig. Every view is rendered as its own tile (side by side) in the same draw call.
+// Defaults to the main camera alone, see loadViewRig
+std::vector<ViewOffset> viewRig = {
+	{0.0f, glm::vec3(0.0f, 0.0f, 0.0f)}
+};
+ViewTransform views[MAX_VIEWS];
+unsigned int viewBuffer;
+
+// Indexed by QualityTier
+const QualitySettings qualityTiers[] = {
+	{3.0f, 0.02f, 0.008f, 4.0f, 24.0f},		// QUALITY_LOW
+	{4.0f, 0.035f, 0.015f, 4.0f, 40.0f},	// QUALITY_MEDIUM
+	{5.0f, 0.05f, 0.03f, 2.0f, 64.0f}		// QUALITY_HIGH
+};
+QualityTier qualityTier = QUALITY_HIGH;
+
 SceneNode* rootNode;
 
+AnimationTracks animationTracks;
+bool lightAnimated = false;
+
+// State the last raymarched frame was rendered with, used to detect when it has to be redrawn
+glm::mat4 renderedViewMatrix;
+double renderedTime = -1.0;
+LightSource renderedLights[numLights];
+
+bool loadViewRig(const std::string& filename) {
+	std::ifstream file(filename.c_str());
+	if (file.fail()) {
+		fprintf(stderr, "Could not open view rig \"%s\"\n", filename.c_str());
+		return false;
+	}
+
+	std::vector<ViewOffset> rig;
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream values(line);
+		ViewOffset view;
+		if (!(values >> view.yaw >> view.offset.x >> view.offset.y >> view.offset.z)) {
+			fprintf(stderr, "Invalid view in \"%s\": %s\n", filename.c_str(), line.c_str());
+			return false;
+		}
+		rig.push_back(view);
+	}
+
+	if (rig.empty() || rig.size() > MAX_VIEWS) {
+		fprintf(stderr, "View rig \"%s\" has %zu views, expected 1 to %u\n", filename.c_str(), rig.size(), MAX_VIEWS);
+		return false;
+	}
+	viewRig = rig;
+	return true;
+}
+
+unsigned int getViewCount() {
+	return std::min<unsigned int>(viewRig.size(), MAX_VIEWS);
+}
+
 void initGame(GLFWwindow* window) {
 
 	int windowWidth, windowHeight;
@@ -78,11 +222,21 @@ void initGame(GLFWwindow* window) {
     glfwSetCursorPosCallback(window,mouseCallback);
 	glfwSetMouseButtonCallback(window, mouseButtonCallback);
 	glfwSetKeyCallback(window, keyCallback);
+	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+	glfwSetWindowRefreshCallback(window, windowRefreshCallback);
 
 	// Create simple shader program
     shader = new Gloom::Shader();
-	std::vector<std::string> basicShaderFiles{"../res/shaders/simple.vert", "../res/shaders/simple.frag"};
-	shader->makeBasicShader(basicShaderFiles);
+	shader->makeCachedShader({"simple.vert", "simple.frag"}, getShaderCacheDirectory());
+
+	// Draws the cached frame to the window
+	presentShader = new Gloom::Shader();
+	presentShader->makeCachedShader({"simple.vert", "present.frag"}, getShaderCacheDirectory());
+
+	// Fills in the pixels a checkerboard frame skipped
+	reconstructShader = new Gloom::Shader();
+	reconstructShader->makeCachedShader({"simple.vert", "checkerboard.frag"}, getShaderCacheDirectory());
+
     shader->activate();
 
 	unsigned int emptyVAO;
@@ -97,6 +251,30 @@ void initGame(GLFWwindow* window) {
 	// Send number of lights to shader
 	glUniform1i(4, numLights);
 
+	// Uniform buffer holding the transforms of all views, shared by every tile of the frame
+	glGenBuffers(1, &viewBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, viewBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, MAX_VIEWS * sizeof(ViewTransform), nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, viewBuffer);
+
+	glUniform1i(2, std::min<int>(viewRig.size(), MAX_VIEWS));
+
+	// Trace every pixel unless a checkerboard frame is being rendered
+	glUniform1i(6, -1);
+
+	// No shadow volumes until the lights have been seen at rest
+	glUniform1i(9, 0);
+	glUniform2i(10, -1, 0);
+
+	// Every part of the scene is evaluated until the first tile masks are uploaded
+	glUniform1i(11, 0);
+
+	// The sea is evaluated in place until the first heightfield is baked
+	glUniform1i(12, -1);
+	glUniform1i(14, 0);
+
+	setQualityTier(qualityTier);
+
 	for (int light = 0; light < numLights; light++) {
 		lightSources[light].lightNode = createSceneNode();
 		lightSources[light].lightNode->vertexArrayObjectID = light;
@@ -115,6 +293,35 @@ void initGame(GLFWwindow* window) {
     getTimeDeltaSeconds();
 }
 
+void enableLightAnimation() {
+	if (lightAnimated) {
+		return;
+	}
+	lightAnimated = true;
+
+	// Let the light circle the temple once a minute
+	addTrack(animationTracks, &lightSources[0].lightNode->position,
+		{ 0.0f, 15.0f, 30.0f, 45.0f, 60.0f },
+		{ glm::vec3(7.0, 0.0, 0.0), glm::vec3(0.0, 0.0, 7.0), glm::vec3(-7.0, 0.0, 0.0), glm::vec3(0.0, 0.0, -7.0), glm::vec3(7.0, 0.0, 0.0) },
+		true);
+}
+
+// Sends the level of detail settings of a quality tier to the shader
+void setQualityTier(QualityTier tier) {
+	qualityTier = tier;
+	const QualitySettings& settings = qualityTiers[tier];
+	glProgramUniform3f(shader->get(), 5, settings.seaOctaves, settings.seaLodFootprint, settings.detailLodFootprint);
+	glProgramUniform2f(shader->get(), 7, settings.reflectionScale, settings.reflectionSteps);
+	sceneDirty = true;
+}
+
+// Switches between tracing every pixel and checkerboard rendering with temporal reconstruction
+void setCheckerboardRendering(bool enabled) {
+	checkerboardEnabled = enabled;
+	historyValid = false;
+	sceneDirty = true;
+}
+
 void renderNode(SceneNode* node) {
 	switch (node->nodeType) {
 	case POINT_LIGHT:
@@ -133,21 +340,362 @@ void renderNode(SceneNode* node) {
 	}
 }
 
+// Checkerboard reconstruction assumes a single view covering the whole image
+static bool useCheckerboard() {
+	return checkerboardEnabled && viewRig.size() == 1;
+}
+
+static void destroyTarget(Gloom::Framebuffer*& target) {
+	if (target != nullptr) {
+		target->destroy();
+		delete target;
+		target = nullptr;
+	}
+}
+
+// Colour plus hit distance and object ID, the inputs of the reconstruction pass
+static Gloom::Framebuffer* createHitTarget(int width, int height) {
+	Gloom::Framebuffer* target = new Gloom::Framebuffer();
+	target->addColorTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+	target->addColorTexture(GL_RG32F, GL_RG, GL_FLOAT, width, height);
+	target->isComplete();
+	return target;
+}
+
+// Fills a light's shadow volume one slice at a time with the shadow volume pass of simple.frag
+static void buildShadowVolume(unsigned int light) {
+	ShadowCache& cache = shadowCaches[light];
+	if (cache.volume == 0) {
+		glGenTextures(1, &cache.volume);
+		glBindTexture(GL_TEXTURE_3D, cache.volume);
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, SHADOW_VOLUME_SIZE.x, SHADOW_VOLUME_SIZE.y, SHADOW_VOLUME_SIZE.z, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	}
+	if (shadowVolumeTarget == nullptr) {
+		shadowVolumeTarget = new Gloom::Framebuffer();
+	}
+
+	// The volume must not be bound for sampling while it is rendered to
+	glActiveTexture(GL_TEXTURE6 + light);
+	glBindTexture(GL_TEXTURE_3D, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	GLboolean blending = glIsEnabled(GL_BLEND);
+	glDisable(GL_BLEND);
+
+	shadowVolumeTarget->bind();
+	glViewport(0, 0, SHADOW_VOLUME_SIZE.x, SHADOW_VOLUME_SIZE.y);
+	for (int slice = 0; slice < SHADOW_VOLUME_SIZE.z; slice++) {
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, cache.volume, 0, slice);
+		glUniform2i(10, light, slice);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+	glUniform2i(10, -1, 0);
+	shadowVolumeTarget->unbind();
+
+	if (blending) {
+		glEnable(GL_BLEND);
+	}
+
+	cache.valid = true;
+	cache.builtPosition = lightSources[light].worldPos;
+}
+
+// Invalidates the shadow volumes of lights that moved, rebuilds those whose light is at rest,
+// and tells the shader which volumes it can use. The light uniforms have to be set already.
+// Fixed pose renders rebuild moved lights right away, so every tile of a frame uses the volume
+static void updateShadowCaches(bool fixedPose) {
+	int validMask = 0;
+	for (unsigned int light = 0; light < numLights; light++) {
+		ShadowCache& cache = shadowCaches[light];
+		glm::vec3 position = lightSources[light].worldPos;
+		bool moving = position != cache.previousPosition;
+		cache.previousPosition = position;
+
+		if (cache.valid && position != cache.builtPosition) {
+			cache.valid = false;
+		}
+		if (!cache.valid && (!moving || fixedPose)) {
+			buildShadowVolume(light);
+		}
+		if (cache.valid) {
+			validMask |= 1 << light;
+			glActiveTexture(GL_TEXTURE6 + light);
+			glBindTexture(GL_TEXTURE_3D, cache.volume);
+		}
+	}
+	glActiveTexture(GL_TEXTURE0);
+	glUniform1i(9, validMask);
+}
+
+// Bakes the wave heights and normals of the sea around the main camera, one cascade at a time with the sea bake pass
+// of simple.frag, and binds them for every view. The frame state has to be applied already. The views, the tiles and
+// the reflection pass of a frame all sample the same bake
+static void updateSeaHeightfield(int imageHeight) {
+	glm::vec3 cameraPosition = camera.getPosition();
+	if (seaBaked && bakedSeaTime == frameTime && bakedSeaCamera == cameraPosition
+		&& bakedSeaImageHeight == imageHeight && bakedSeaTier == qualityTier) {
+		return;
+	}
+
+	if (seaHeightfield == 0) {
+		glGenTextures(1, &seaHeightfield);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, seaHeightfield);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA16F, SEA_HEIGHTFIELD_SIZE, SEA_HEIGHTFIELD_SIZE, SEA_CASCADES, 0, GL_RGBA, GL_FLOAT, nullptr);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	if (seaBakeTarget == nullptr) {
+		seaBakeTarget = new Gloom::Framebuffer();
+	}
+
+	// The heightfield must not be bound for sampling while it is rendered to
+	glActiveTexture(GL_TEXTURE10);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glUniform1i(14, 0);
+
+	GLboolean blending = glIsEnabled(GL_BLEND);
+	glDisable(GL_BLEND);
+
+	glUniform3fv(13, 1, glm::value_ptr(cameraPosition));
+	seaBakeTarget->bind();
+	glViewport(0, 0, SEA_HEIGHTFIELD_SIZE, SEA_HEIGHTFIELD_SIZE);
+	for (int cascade = 0; cascade < SEA_CASCADES; cascade++) {
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, seaHeightfield, 0, cascade);
+		glUniform1i(12, cascade);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+	glUniform1i(12, -1);
+	seaBakeTarget->unbind();
+
+	if (blending) {
+		glEnable(GL_BLEND);
+	}
+
+	glActiveTexture(GL_TEXTURE10);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, seaHeightfield);
+	glActiveTexture(GL_TEXTURE0);
+	glUniform1i(14, 1);
+
+	seaBaked = true;
+	bakedSeaTime = frameTime;
+	bakedSeaCamera = cameraPosition;
+	bakedSeaImageHeight = imageHeight;
+	bakedSeaTier = qualityTier;
+}
+
+// Whether the tile masks were found for the current views and image, in a region containing the given one
+static bool tilePruningCurrent(unsigned int numViews, int imageWidth, int imageHeight, glm::ivec4 region) {
+	if (numViews != prunedNumViews || imageWidth != prunedWidth || imageHeight != prunedHeight) {
+		return false;
+	}
+	if (region.x < prunedRegion.x || region.y < prunedRegion.y
+		|| region.x + region.z > prunedRegion.x + prunedRegion.z || region.y + region.w > prunedRegion.y + prunedRegion.w) {
+		return false;
+	}
+	for (unsigned int view = 0; view < numViews; view++) {
+		if (views[view].position != prunedViews[view].position || views[view].cameraToWorld != prunedViews[view].cameraToWorld) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Finds the parts of the scene the screen tiles overlapping a region of pixels need for the current views, and
+// uploads the masks for the main pass. Masks are reused while the views and the image stay the same
+static void updateTilePruning(int imageWidth, int imageHeight, int regionX, int regionY, int regionWidth, int regionHeight) {
+	unsigned int numViews = std::min<unsigned int>(viewRig.size(), MAX_VIEWS);
+	glm::ivec4 region(regionX, regionY, regionWidth, regionHeight);
+	if (tilePruningCurrent(numViews, imageWidth, imageHeight, region)) {
+		return;
+	}
+	pruneTiles(views, numViews, imageWidth, imageHeight, PRUNE_TILE_SIZE, regionX, regionY, regionWidth, regionHeight, tileParts);
+	std::copy(views, views + numViews, prunedViews);
+	prunedNumViews = numViews;
+	prunedWidth = imageWidth;
+	prunedHeight = imageHeight;
+	prunedRegion = region;
+
+	if (tilePartsTexture == 0) {
+		glGenTextures(1, &tilePartsTexture);
+		glBindTexture(GL_TEXTURE_2D, tilePartsTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+
+	int tilesX = (imageWidth + PRUNE_TILE_SIZE - 1) / PRUNE_TILE_SIZE;
+	int tilesY = (imageHeight + PRUNE_TILE_SIZE - 1) / PRUNE_TILE_SIZE;
+	glActiveTexture(GL_TEXTURE9);
+	glBindTexture(GL_TEXTURE_2D, tilePartsTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, tilesX, tilesY, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, tileParts.data());
+	glActiveTexture(GL_TEXTURE0);
+
+	glUniform1i(11, PRUNE_TILE_SIZE);
+}
+
+// Marches the sea reflections of a tile of the image into the reflection buffer and binds it for the main pass
+static void renderReflections(int imageWidth, int imageHeight, int tileX, int tileY, int tileWidth, int tileHeight) {
+	int scale = int(qualityTiers[qualityTier].reflectionScale);
+	int width = (imageWidth + scale - 1) / scale;
+	int height = (imageHeight + scale - 1) / scale;
+	if (reflectionTarget == nullptr || reflectionWidth != width || reflectionHeight != height) {
+		destroyTarget(reflectionTarget);
+		reflectionTarget = createHitTarget(width, height);
+		reflectionWidth = width;
+		reflectionHeight = height;
+	}
+
+	// The depth target has no alpha, so blending would read undefined values
+	GLboolean blending = glIsEnabled(GL_BLEND);
+	glDisable(GL_BLEND);
+
+	// Upsampling reads the neighbouring texels, so the tile is extended by one texel on every side
+	reflectionTarget->bind();
+	glViewport(0, 0, width, height);
+	glEnable(GL_SCISSOR_TEST);
+	int x0 = std::max(tileX / scale - 1, 0);
+	int y0 = std::max(tileY / scale - 1, 0);
+	glScissor(x0, y0, (tileX + tileWidth) / scale + 2 - x0, (tileY + tileHeight) / scale + 2 - y0);
+	glUniform1i(8, 1);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glUniform1i(8, 0);
+	glDisable(GL_SCISSOR_TEST);
+	reflectionTarget->unbind();
+
+	if (blending) {
+		glEnable(GL_BLEND);
+	}
+
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_2D, reflectionTarget->getTexture(0));
+	glActiveTexture(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_2D, reflectionTarget->getTexture(1));
+	glActiveTexture(GL_TEXTURE0);
+}
+
+// Traces half of the pixels and reconstructs the full frame into the next history target
+// When nothing changed since the previous frame, it traced exactly the pixels this frame skips
+static void renderCheckerboardFrame(int width, int height, bool sceneChanged) {
+	if (traceTarget == nullptr) {
+		traceTarget = createHitTarget((width + 1) / 2, height);
+		historyTargets[0] = createHitTarget(width, height);
+		historyTargets[1] = createHitTarget(width, height);
+		historyValid = false;
+	}
+
+	renderNode(rootNode);
+	updateShadowCaches(false);
+	updateSeaHeightfield(height);
+	updateTilePruning(width, height, 0, 0, width, height);
+	renderReflections(width, height, 0, 0, width, height);
+
+	// The hit target has no alpha, so blending would read undefined values
+	glDisable(GL_BLEND);
+
+	traceTarget->bind();
+	glViewport(0, 0, (width + 1) / 2, height);
+	glUniform1i(6, checkerboardPhase);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glUniform1i(6, -1);
+	traceTarget->unbind();
+
+	int previous = historyIndex;
+	historyIndex = 1 - historyIndex;
+
+	historyTargets[historyIndex]->bind();
+	glViewport(0, 0, width, height);
+	reconstructShader->activate();
+	glUniform2f(0, float(width), float(height));
+	glUniform1i(1, checkerboardPhase);
+	glUniform3fv(2, 1, glm::value_ptr(glm::vec3(views[0].position)));
+	glUniformMatrix4fv(3, 1, GL_FALSE, glm::value_ptr(views[0].cameraToWorld));
+	glUniform3fv(4, 1, glm::value_ptr(glm::vec3(previousView.position)));
+	glUniformMatrix4fv(5, 1, GL_FALSE, glm::value_ptr(glm::transpose(previousView.cameraToWorld)));
+	glUniform1i(6, historyValid ? 1 : 0);
+	glUniform1i(7, (historyValid && !sceneChanged) ? 1 : 0);
+
+	GLuint inputs[4] = {
+		traceTarget->getTexture(0), traceTarget->getTexture(1),
+		historyTargets[previous]->getTexture(0), historyTargets[previous]->getTexture(1)
+	};
+	for (unsigned int unit = 0; unit < 4; unit++) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, inputs[unit]);
+	}
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	historyTargets[historyIndex]->unbind();
+	glActiveTexture(GL_TEXTURE0);
+
+	shader->activate();
+	glEnable(GL_BLEND);
+
+	previousView = views[0];
+	historyValid = true;
+	checkerboardPhase = 1 - checkerboardPhase;
+}
+
 void updateFrame(GLFWwindow* window) {
     double timeDelta = getTimeDeltaSeconds();
 
-	// Send elapsed time to shader
-	float elapsedTime = (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count()) / 1000000.0;
-	glUniform1f(1, elapsedTime);
+	// Animation time only advances while not paused
+	if (!isPaused) {
+		gameElapsedTime += timeDelta;
+	}
 
-	// Update camera and send position to shader
 	camera.updateCamera(timeDelta);
-	glUniform3fv(2, 1, glm::value_ptr(camera.getPosition()));
-	glUniformMatrix4fv(3, 1, GL_FALSE, glm::value_ptr(camera.getRotation()));
+	applyFrameState(float(gameElapsedTime));
 
+	// The frame has to be raymarched again if the camera, the time or any light changed
+	if (camera.getViewMatrix() != renderedViewMatrix || gameElapsedTime != renderedTime) {
+		sceneDirty = true;
+	}
+	for (unsigned int light = 0; light < numLights; light++) {
+		if (lightSources[light].worldPos != renderedLights[light].worldPos || lightSources[light].color != renderedLights[light].color) {
+			sceneDirty = true;
+		}
+	}
+}
+
+// Whether renderFrame would draw anything new
+bool needsRedraw() {
+	return sceneDirty || convergencePending || presentNeeded;
+}
+
+// Sends the state shared by every view and tile of a frame to the shader
+void applyFrameState(float elapsedTime) {
+	shader->activate();
+	glUniform1f(1, elapsedTime);
+	frameTime = elapsedTime;
+	updateViews();
+	evaluateTracks(animationTracks, elapsedTime);
 	updateNodeTransformations(rootNode, glm::mat4(1.0f), glm::mat4(1.0f));
 }
 
+// Derives every view of the rig from the main camera and uploads them in one buffer update
+void updateViews() {
+	unsigned int numViews = std::min<unsigned int>(viewRig.size(), MAX_VIEWS);
+
+	// Camera rotation is orthonormal, so the transpose is the camera-to-world rotation
+	glm::mat4 cameraToWorld = glm::transpose(camera.getRotation());
+
+	for (unsigned int view = 0; view < numViews; view++) {
+		glm::vec3 offset = glm::vec3(cameraToWorld * glm::vec4(viewRig[view].offset, 0.0f));
+		views[view].position = glm::vec4(camera.getPosition() + offset, 1.0f);
+		views[view].cameraToWorld = cameraToWorld * glm::rotate(viewRig[view].yaw, glm::vec3(0, 1, 0));
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, viewBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, numViews * sizeof(ViewTransform), views);
+}
+
 void updateNodeTransformations(SceneNode* node, glm::mat4 transformationThusFar, glm::mat4 viewProjection) {
     glm::mat4 transformationMatrix =
               glm::translate(node->position)
@@ -164,10 +712,12 @@ void updateNodeTransformations(SceneNode* node, glm::mat4 transformationThusFar,
     switch(node->nodeType) {
         case GEOMETRY: break;
 		case POINT_LIGHT:
+		{
 			// Calculating the world coordinates of a light source by multiplying the transformation matrix by the origin of the world space
 			glm::vec4 origin = glm::vec4(0, 0, 0, 1.0);
 			lightSources[node->vertexArrayObjectID].worldPos = glm::vec3(node->currentTransformationMatrix * origin);
-			break;
+		}
+		break;
         case SPOT_LIGHT: break;
     }
 
@@ -179,9 +729,112 @@ void updateNodeTransformations(SceneNode* node, glm::mat4 transformationThusFar,
 void renderFrame(GLFWwindow* window) {
     int windowWidth, windowHeight;
     glfwGetWindowSize(window, &windowWidth, &windowHeight);
-    glViewport(0, 0, windowWidth, windowHeight);
 
+	// Recreate the frame cache when the window size changed
+	if (frameCache == nullptr || frameCacheWidth != windowWidth || frameCacheHeight != windowHeight) {
+		if (frameCache != nullptr) {
+			frameCache->destroy();
+			delete frameCache;
+		}
+		frameCache = new Gloom::Framebuffer();
+		frameCache->addColorTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, windowWidth, windowHeight);
+		frameCache->isComplete();
+		frameCacheWidth = windowWidth;
+		frameCacheHeight = windowHeight;
+
+		// Checkerboard targets are recreated at the new size when next used
+		destroyTarget(traceTarget);
+		destroyTarget(historyTargets[0]);
+		destroyTarget(historyTargets[1]);
+
+		glUniform2f(0, float(windowWidth), float(windowHeight));
+		sceneDirty = true;
+	}
+
+	// Raymarch into the cache only when something changed since the last frame
+	bool checkerboard = useCheckerboard();
+	if (sceneDirty || (convergencePending && checkerboard)) {
+		if (checkerboard) {
+			renderCheckerboardFrame(windowWidth, windowHeight, sceneDirty);
+		} else {
+			renderNode(rootNode);
+			updateShadowCaches(false);
+			updateSeaHeightfield(windowHeight);
+			updateTilePruning(windowWidth, windowHeight, 0, 0, windowWidth, windowHeight);
+			renderReflections(windowWidth, windowHeight, 0, 0, windowWidth, windowHeight);
+
+			frameCache->bind();
+			glViewport(0, 0, windowWidth, windowHeight);
+
+			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+			frameCache->unbind();
+		}
+
+		renderedViewMatrix = camera.getViewMatrix();
+		renderedTime = gameElapsedTime;
+		std::copy(lightSources, lightSources + numLights, renderedLights);
+
+		// A checkerboard frame of a changed scene is only half traced, so the other half is traced once the scene is still
+		convergencePending = checkerboard && sceneDirty;
+		sceneDirty = false;
+	}
+
+	// Present the cached frame
+	glViewport(0, 0, windowWidth, windowHeight);
+	presentShader->activate();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, checkerboard ? historyTargets[historyIndex]->getTexture(0) : frameCache->getTexture(0));
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	shader->activate();
+	presentNeeded = false;
+}
+
+// Draws one tile of an image to the offscreen target at a fixed camera pose
+void drawTile(const CameraPose& pose, int imageWidth, int imageHeight, int tileX, int tileY, int tileWidth, int tileHeight) {
+	static int targetWidth = 0;
+	static int targetHeight = 0;
+
+	// The target covers the whole image so tiles keep their pixel coordinates in the shader
+	if (offscreenTarget == nullptr || targetWidth != imageWidth || targetHeight != imageHeight) {
+		if (offscreenTarget != nullptr) {
+			offscreenTarget->destroy();
+			delete offscreenTarget;
+		}
+		offscreenTarget = new Gloom::Framebuffer();
+		offscreenTarget->addColorTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, imageWidth, imageHeight);
+		offscreenTarget->isComplete();
+		targetWidth = imageWidth;
+		targetHeight = imageHeight;
+	}
+
+	camera.setPose(pose.position, pose.yaw, pose.pitch);
+	applyFrameState(pose.time);
+
+	glUniform2f(0, float(imageWidth), float(imageHeight));
 	renderNode(rootNode);
+	updateShadowCaches(true);
+	updateSeaHeightfield(imageHeight);
+	updateTilePruning(imageWidth, imageHeight, tileX, tileY, tileWidth, tileHeight);
+	renderReflections(imageWidth, imageHeight, tileX, tileY, tileWidth, tileHeight);
 
+	offscreenTarget->bind();
+	glViewport(0, 0, imageWidth, imageHeight);
+
+	// Only the pixels inside the scissor rectangle are shaded
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(tileX, tileY, tileWidth, tileHeight);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glDisable(GL_SCISSOR_TEST);
+	offscreenTarget->unbind();
+}
+
+// Renders one tile of an image offscreen at a fixed camera pose and reads back its RGBA8 pixels (bottom row first)
+void renderTile(const CameraPose& pose, int imageWidth, int imageHeight, int tileX, int tileY, int tileWidth, int tileHeight, std::vector<unsigned char>& pixels) {
+	drawTile(pose, imageWidth, imageHeight, tileX, tileY, tileWidth, tileHeight);
+
+	offscreenTarget->bind();
+	pixels.resize(size_t(tileWidth) * tileHeight * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(tileX, tileY, tileWidth, tileHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	offscreenTarget->unbind();
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <utilities/window.hpp>
+#include <GLFW/glfw3.h>
 #include <vector>
 #include "sceneGraph.hpp"
 
@@ -12,9 +13,68 @@ struct LightSource {
 };
 // LightSource lightSources[/*Put number of light sources you want here*/];
 
+// Maximum number of views rendered in a single pass. Must match MAX_VIEWS in simple.frag
+const unsigned int MAX_VIEWS = 8;
+
+// Offset of a view relative to the main camera. Stereo pairs use a sideways offset, projector walls a yaw angle
+struct ViewOffset {
+	float yaw;
+	glm::vec3 offset;
+};
+
+// Transform of a single view, laid out to match the std140 ViewBlock in simple.frag
+struct ViewTransform {
+	glm::vec4 position;			// w is padding
+	glm::mat4 cameraToWorld;	// Rotation from camera space to world space
+};
+
+// Voxels of each light's soft shadow volume. Must match SHADOW_VOLUME_SIZE in simple.frag
+const glm::ivec3 SHADOW_VOLUME_SIZE(210, 66, 110);
+
+// Soft shadows towards one light, cached in a volume texture
+struct ShadowCache {
+	unsigned int volume;			// 3D texture, created on first build
+	bool valid;
+	glm::vec3 builtPosition;		// Light position the volume holds shadows for
+	glm::vec3 previousPosition;		// Light position at the last update, to tell whether the light is still moving
+};
+
+// Level of detail settings per quality tier, see lodSettings in simple.frag
+enum QualityTier {
+	QUALITY_LOW, QUALITY_MEDIUM, QUALITY_HIGH
+};
+
+struct QualitySettings {
+	float seaOctaves;			// Octaves used for the sea close to the camera
+	float seaLodFootprint;		// Pixel footprint (world units) where sea octaves start dropping
+	float detailLodFootprint;	// Pixel footprint (world units) where column detail starts fading to bounding shapes
+	float reflectionScale;		// Resolution divisor of the sea reflection buffer
+	float reflectionSteps;		// Step budget of reflected rays
+};
+
+// Fixed camera pose and animation time, used when rendering without user input
+struct CameraPose {
+	float time;
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+};
+
 void updateNodeTransformations(SceneNode* node, glm::mat4 transformationThusFar, glm::mat4 viewProjection);
+// Reads the view rig from a file with one "yaw x y z" line per view, see ViewOffset. Lines starting with '#' are
+// comments. Fails for files with more than MAX_VIEWS views and leaves the current rig in place
+bool loadViewRig(const std::string& filename);
+// Number of views in the loaded rig
+unsigned int getViewCount();
 void initGame(GLFWwindow* window);
 void updateFrame(GLFWwindow* window);
 void renderFrame(GLFWwindow* window);
-
-std::vector<glm::mat4> lightSpaceTransform(glm::mat4 projection, LightSource light);
\ No newline at end of file
+bool needsRedraw();
+void updateViews();
+void applyFrameState(float elapsedTime);
+void drawTile(const CameraPose& pose, int imageWidth, int imageHeight, int tileX, int tileY, int tileWidth, int tileHeight);
+void renderTile(const CameraPose& pose, int imageWidth, int imageHeight, int tileX, int tileY, int tileWidth, int tileHeight, std::vector<unsigned char>& pixels);
+void setQualityTier(QualityTier tier);
+void setCheckerboardRendering(bool enabled);
+// The light is static unless this is called after initGame
+void enableLightAnimation();
\ No newline at end of file
@@ -1,13 +1,20 @@
 // Local headers
 #include "utilities/window.hpp"
 #include "program.hpp"
+#include "gamelogic.h"
+#include "farm/coordinator.hpp"
+#include "farm/worker.hpp"
+#include "benchmark.hpp"
+#include "utilities/shaderSources.h"
 
 // System headers
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 // Standard headers
+#include <arrrgh.hpp>
 #include <cstdlib>
+#include <iostream>
 
 // A callback which allows GLFW to report errors whenever they occur
 static void glfwErrorCallback(int error, const char *description)
@@ -16,7 +23,8 @@ static void glfwErrorCallback(int error, const char *description)
 }
 
 
-GLFWwindow* initialise()
+// Opens a window of the given width and the default height, hidden for the headless modes
+GLFWwindow* initialise(bool visible, int width)
 {
     // Initialise GLFW
     if (!glfwInit())
@@ -37,8 +45,11 @@ GLFWwindow* initialise()
     glfwWindowHint(GLFW_RESIZABLE, windowResizable);
     glfwWindowHint(GLFW_SAMPLES, windowSamples);  // MSAA
 
+    // Headless modes only need the OpenGL context
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+
     // Create window using GLFW
-    GLFWwindow* window = glfwCreateWindow(windowWidth,
+    GLFWwindow* window = glfwCreateWindow(width,
                                           windowHeight,
                                           windowTitle.c_str(),
                                           nullptr,
@@ -68,11 +79,116 @@ GLFWwindow* initialise()
 
 int main(int argc, const char* argb[])
 {
-    // Initialise window using GLFW
-    GLFWwindow* window = initialise();
+    arrrgh::parser parser("raymarching", "Raymarched temple by the sea");
+    const auto& showHelp     = parser.add<bool>("help", "Show this help message.", 'h', arrrgh::Optional, false);
+    const auto& coordinator  = parser.add<bool>("coordinator", "Render an animation by distributing tiles to render workers.", 'c', arrrgh::Optional, false);
+    const auto& worker       = parser.add<std::string>("worker", "Run as a headless render worker for the coordinator at this address.", 'w', arrrgh::Optional, "");
+    const auto& address      = parser.add<std::string>("address", "Coordinator address, unix:<path> or tcp:<host>:<port>.", 'a', arrrgh::Optional, "unix:/tmp/raymarching-farm.sock");
+    const auto& localWorkers = parser.add<int>("local-workers", "Number of workers the coordinator starts on this machine.", 'n', arrrgh::Optional, 4);
+    const auto& cameraPath   = parser.add<std::string>("camera-path", "Camera keyframes, one \"time x y z yaw pitch\" per line.", 'p', arrrgh::Optional, "");
+    const auto& startTime    = parser.add<float>("start", "Animation start time in seconds.", 's', arrrgh::Optional, 0.0f);
+    const auto& endTime      = parser.add<float>("end", "Animation end time in seconds.", 'e', arrrgh::Optional, 0.0f);
+    const auto& fps          = parser.add<float>("fps", "Frames per second of the rendered sequence.", 'f', arrrgh::Optional, 30.0f);
+    const auto& imageWidth   = parser.add<int>("width", "Width of rendered frames.", 'x', arrrgh::Optional, windowWidth);
+    const auto& imageHeight  = parser.add<int>("height", "Height of rendered frames.", 'y', arrrgh::Optional, windowHeight);
+    const auto& tileSize     = parser.add<int>("tile-size", "Size of the square tiles frames are split into.", 't', arrrgh::Optional, 128);
+    const auto& output       = parser.add<std::string>("output", "Directory finished frames are written to.", 'o', arrrgh::Optional, "frames");
+    const auto& benchmark    = parser.add<bool>("benchmark", "Run the performance regression suite headless.", 'b', arrrgh::Optional, false);
+    const auto& repetitions  = parser.add<int>("repetitions", "Timed renders per benchmark case.", 'r', arrrgh::Optional, 30);
+    const auto& updateRefs   = parser.add<bool>("update-references", "Write new benchmark golden images and baseline.", 'u', arrrgh::Optional, false);
+    const auto& results      = parser.add<std::string>("results", "File the benchmark results are written to (JSON).", 'j', arrrgh::Optional, "benchmark_results.json");
+    const auto& onDemand     = parser.add<bool>("on-demand", "Only render when the camera, lights or time changed. Press P to pause the sea.", 'i', arrrgh::Optional, false);
+    const auto& checkerboard = parser.add<bool>("checkerboard", "Trace half of the pixels per frame and reconstruct the rest. Toggle with C.", 'k', arrrgh::Optional, false);
+    const auto& animateLight = parser.add<bool>("animate-light", "Move the light around the temple once a minute.", 'l', arrrgh::Optional, false);
+    const auto& viewRigFile  = parser.add<std::string>("view-rig", "Views rendered side by side, one \"yaw x y z\" offset from the camera per line.", 'v', arrrgh::Optional, "");
+    const auto& shaderDir    = parser.add<std::string>("shader-dir", "Load shaders from this directory instead of the embedded copies.", 'd', arrrgh::Optional, "");
+
+    try
+    {
+        parser.parse(argc, argb);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error parsing arguments: " << e.what() << std::endl;
+        parser.show_usage(std::cerr);
+        exit(EXIT_FAILURE);
+    }
+
+    if (showHelp.value())
+    {
+        parser.show_usage(std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    setShaderOverrideDirectory(shaderDir.value());
+
+    // The coordinator does not render, so it runs without OpenGL
+    if (coordinator.value())
+    {
+        Farm::CoordinatorSettings settings;
+        settings.address         = address.value();
+        settings.localWorkers    = localWorkers.value();
+        settings.cameraPath      = cameraPath.value();
+        settings.startTime       = startTime.value();
+        settings.endTime         = endTime.value();
+        settings.framesPerSecond = fps.value();
+        settings.imageWidth      = imageWidth.value();
+        settings.imageHeight     = imageHeight.value();
+        settings.tileSize        = tileSize.value();
+        settings.framesInFlight  = 2;
+        settings.maxRetries      = 3;
+        settings.stealFactor     = 3.0f;
+        settings.outputDirectory = output.value();
+        return Farm::runCoordinator(settings);
+    }
+
+    if (!worker.value().empty())
+    {
+        GLFWwindow* window = initialise(false, windowWidth);
+        int result = Farm::runWorker(window, worker.value());
+        glfwTerminate();
+        return result;
+    }
+
+    if (benchmark.value())
+    {
+        std::string benchmarkDir = std::string(PROJECT_SOURCE_DIR) + "/res/benchmark";
+        BenchmarkSettings settings;
+        settings.casesFile           = benchmarkDir + "/cases.txt";
+        settings.goldenDirectory     = benchmarkDir + "/golden";
+        settings.baselineFile        = benchmarkDir + "/baseline.txt";
+        settings.resultsFile         = results.value();
+        settings.imageWidth          = imageWidth.value();
+        settings.imageHeight         = imageHeight.value();
+        settings.repetitions         = repetitions.value();
+        settings.maxMeanDeltaE       = 1.0f;
+        settings.maxPercentileDeltaE = 5.0f;
+        settings.minRegression       = 0.03f;
+        settings.updateReferences    = updateRefs.value();
+
+        GLFWwindow* window = initialise(false, windowWidth);
+        int result = runBenchmark(window, settings);
+        glfwTerminate();
+        return result;
+    }
+
+    if (!viewRigFile.value().empty() && !loadViewRig(viewRigFile.value()))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Initialise window using GLFW. Views are tiled side by side, so every view gets the full default width
+    GLFWwindow* window = initialise(true, windowWidth * int(getViewCount()));
+
+    CommandLineOptions options;
+    options.enableMusic    = false;
+    options.enableAutoplay = false;
+    options.renderOnDemand = onDemand.value();
+    options.checkerboard   = checkerboard.value();
+    options.animateLight   = animateLight.value();
 
     // Run an OpenGL application using this window
-    runProgram(window);
+    runProgram(window, options);
 
     // Terminate GLFW (no need to call glfwDestroyWindow)
     glfwTerminate();
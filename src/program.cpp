@@ -11,7 +11,11 @@
 #include <utilities/timeutils.h>
 
 
-void runProgram(GLFWwindow* window)
+// How long an idle on-demand loop sleeps before checking for changes again
+const double idleWaitSeconds = 0.25;
+
+
+void runProgram(GLFWwindow* window, CommandLineOptions options)
 {
     // Enable depth (Z) buffer (accept "closest" fragment)
     glEnable(GL_DEPTH_TEST);
@@ -31,22 +35,36 @@ void runProgram(GLFWwindow* window)
     glClearColor(0.3f, 0.5f, 0.8f, 1.0f);
 
 	initGame(window);
+	setCheckerboardRendering(options.checkerboard);
+	if (options.animateLight)
+	{
+		enableLightAnimation();
+	}
 
     // Rendering Loop
     while (!glfwWindowShouldClose(window))
     {
-	    // Clear colour and depth buffers
-	    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
         updateFrame(window);
-        renderFrame(window);
 
-        // Handle other events
-        glfwPollEvents();
-        handleKeyboardInput(window);
+        // In on-demand mode nothing is drawn while the image is unchanged, and the loop sleeps until an event arrives
+        if (!options.renderOnDemand || needsRedraw())
+        {
+            // Clear colour and depth buffers
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Flip buffers
-        glfwSwapBuffers(window);
+            renderFrame(window);
+
+            // Flip buffers
+            glfwSwapBuffers(window);
+
+            // Handle other events
+            glfwPollEvents();
+        }
+        else
+        {
+            glfwWaitEventsTimeout(idleWaitSeconds);
+        }
+        handleKeyboardInput(window);
     }
 }
 
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+// Interval arithmetic mirror of the SDF operations in simple.frag.
+//
+// Every function returns an interval containing all values the shader function can take for arguments inside
+// the argument intervals. The bounds are conservative: they may be wider than the true range, never narrower.
+
+struct Interval {
+	float lo;
+	float hi;
+};
+
+// Axis aligned box of points
+struct IntervalVec3 {
+	Interval x;
+	Interval y;
+	Interval z;
+};
+
+inline Interval operator+(Interval a, Interval b) { return { a.lo + b.lo, a.hi + b.hi }; }
+inline Interval operator-(Interval a, Interval b) { return { a.lo - b.hi, a.hi - b.lo }; }
+inline Interval operator-(Interval a) { return { -a.hi, -a.lo }; }
+inline Interval operator+(Interval a, float b) { return { a.lo + b, a.hi + b }; }
+inline Interval operator-(Interval a, float b) { return { a.lo - b, a.hi - b }; }
+
+inline IntervalVec3 operator-(const IntervalVec3& p, glm::vec3 offset) {
+	return { p.x - offset.x, p.y - offset.y, p.z - offset.z };
+}
+
+inline Interval min(Interval a, Interval b) { return { std::min(a.lo, b.lo), std::min(a.hi, b.hi) }; }
+inline Interval max(Interval a, Interval b) { return { std::max(a.lo, b.lo), std::max(a.hi, b.hi) }; }
+
+inline Interval abs(Interval a) {
+	if (a.lo >= 0.0f) {
+		return a;
+	}
+	if (a.hi <= 0.0f) {
+		return -a;
+	}
+	return { 0.0f, std::max(-a.lo, a.hi) };
+}
+
+inline Interval square(Interval a) {
+	Interval magnitude = abs(a);
+	return { magnitude.lo * magnitude.lo, magnitude.hi * magnitude.hi };
+}
+
+inline Interval sqrt(Interval a) {
+	return { std::sqrt(std::max(a.lo, 0.0f)), std::sqrt(std::max(a.hi, 0.0f)) };
+}
+
+inline Interval length(Interval x, Interval y) {
+	return sqrt(square(x) + square(y));
+}
+
+inline Interval length(Interval x, Interval y, Interval z) {
+	return sqrt(square(x) + square(y) + square(z));
+}
+
+/*======================================================================================*/
+// SDF operations
+
+// The domain of one component of opRepeatLim: the union of the local coordinates of every repetition the interval overlaps
+inline Interval opRepeatLim(Interval p, float period, float length) {
+	float firstCell = glm::clamp(std::round(p.lo / period), -length, length);
+	float lastCell = glm::clamp(std::round(p.hi / period), -length, length);
+
+	Interval result = { INFINITY, -INFINITY };
+	for (float cell = firstCell; cell <= lastCell; cell += 1.0f) {
+		float lo = (cell == firstCell) ? p.lo : (cell - 0.5f) * period;
+		float hi = (cell == lastCell) ? p.hi : (cell + 0.5f) * period;
+		result.lo = std::min(result.lo, lo - cell * period);
+		result.hi = std::max(result.hi, hi - cell * period);
+	}
+	return result;
+}
+
+inline IntervalVec3 opRepeatLim(const IntervalVec3& p, float period, glm::vec3 length) {
+	return { opRepeatLim(p.x, period, length.x), opRepeatLim(p.y, period, length.y), opRepeatLim(p.z, period, length.z) };
+}
+
+/*======================================================================================*/
+// Signed distance functions
+
+inline Interval boxSDF(const IntervalVec3& p, glm::vec3 size) {
+	const Interval zero = { 0.0f, 0.0f };
+	Interval dx = abs(p.x) - size.x;
+	Interval dy = abs(p.y) - size.y;
+	Interval dz = abs(p.z) - size.z;
+	return min(max(dx, max(dy, dz)), zero) + length(max(dx, zero), max(dy, zero), max(dz, zero));
+}
+
+// Same (radius, len) parameter order as cylinderSDF in simple.frag: radius is the half height, len the radius
+inline Interval cylinderSDF(const IntervalVec3& p, float radius, float len) {
+	const Interval zero = { 0.0f, 0.0f };
+	Interval dx = length(p.x, p.z) - len;
+	Interval dy = abs(p.y) - radius;
+	return min(max(dx, dy), zero) + length(max(dx, zero), max(dy, zero));
+}
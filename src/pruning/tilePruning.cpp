@@ -0,0 +1,177 @@
+#include "tilePruning.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Scene bounds and field of view, must match simple.frag
+const glm::vec3 SCENE_BOUNDS_MIN(-25.0f, -8.0f, -25.0f);
+const glm::vec3 SCENE_BOUNDS_MAX(25.0f, 2.5f, 25.0f);
+const float FOV = 2.0f;
+
+// Depth slices each tile frustum is split into. Thinner slices give tighter bounds at a higher CPU cost
+const int FRUSTUM_SLICES = 8;
+
+// sMin in columnDetailSDF can dip below both of its arguments by k / 6
+const float COLUMN_BLEND_MARGIN = 0.5f / 6.0f;
+
+// Rounding differs between the CPU and the GPU, so parts are only dropped when they lose by more than this
+const float PRUNE_EPSILON = 1e-3f;
+
+// Whether subtracting cut from shape can change the distance somewhere in the region
+static bool cutsInto(Interval shape, Interval cut) {
+	return -cut.lo >= shape.lo - PRUNE_EPSILON;
+}
+
+unsigned int visibleSceneParts(const IntervalVec3& point) {
+	unsigned int parts = 0;
+
+	// Ground
+	Interval ground = boxSDF(point - glm::vec3(0.0f, -7.0f, 0.0f), glm::vec3(25.0f, 1.0f, 25.0f));
+
+	// Columns. Both the detailed and the bounding shape lie between the bounding cylinders minus the blend margin,
+	// and the shaft plus the depth of the flutes
+	IntervalVec3 columnPoint = opRepeatLim(point, 4.35f, glm::vec3(2.0f, 0.0f, 1.0f));
+	columnPoint.y = abs(columnPoint.y) + 0.2f;
+	Interval shaft = cylinderSDF(columnPoint, 2.0f, 0.3f);
+	Interval capital = cylinderSDF(columnPoint - glm::vec3(0.0f, 2.0f, 0.0f), 0.05f, 0.45f) - 0.02f;
+	Interval column = { std::min(shaft.lo, capital.lo) - COLUMN_BLEND_MARGIN, std::max(shaft.hi, 0.02f) };
+	column = min(column, boxSDF(columnPoint - glm::vec3(0.0f, 2.14f, 0.0f), glm::vec3(0.5f, 0.08f, 0.5f)) - 0.02f);
+
+	Interval columnGap = boxSDF(point - glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(10.0f, 2.5f, 2.0f));
+	if (cutsInto(column, columnGap)) {
+		column = max(column, -columnGap);
+		parts |= PART_COLUMN_GAP;
+	}
+
+	// First level floor
+	IntervalVec3 floorPoint = opRepeatLim(point - glm::vec3(0.0f, -2.0f, -2.90f), 1.45f, glm::vec3(7.0f, 0.0f, 3.0f));
+	Interval floor = boxSDF(floorPoint, glm::vec3(0.7f, 0.05f, 0.7f)) - 0.03f;
+
+	Interval floorGap = boxSDF(point - glm::vec3(0.0f, -2.0f, -7.27f), glm::vec3(11.0f, 0.5f, 0.75f));
+	if (cutsInto(floor, floorGap)) {
+		floor = max(floor, -floorGap);
+		parts |= PART_FLOOR_GAP;
+	}
+
+	// First level roof
+	Interval roof = boxSDF(point - glm::vec3(0.0f, 2.1f, -2.2f), glm::vec3(9.6f, 0.1f, 3.0f)) - 0.03f;
+
+	// A part of the union is needed unless another part is closer everywhere in the region
+	const Interval distances[] = { ground, column, floor, roof };
+	const unsigned int bits[] = { PART_GROUND, PART_COLUMNS, PART_FLOOR, PART_ROOF };
+	for (int part = 0; part < 4; part++) {
+		float othersHi = INFINITY;
+		for (int other = 0; other < 4; other++) {
+			if (other != part) {
+				othersHi = std::min(othersHi, distances[other].hi);
+			}
+		}
+		if (distances[part].lo <= othersHi + PRUNE_EPSILON) {
+			parts |= bits[part];
+		}
+	}
+	return parts;
+}
+
+static void includePoint(IntervalVec3& region, glm::vec3 point) {
+	region.x = { std::min(region.x.lo, point.x), std::max(region.x.hi, point.x) };
+	region.y = { std::min(region.y.lo, point.y), std::max(region.y.hi, point.y) };
+	region.z = { std::min(region.z.lo, point.z), std::max(region.z.hi, point.z) };
+}
+
+// Intersects the region with the scene bounds. Returns false when nothing is left
+static bool clipToSceneBounds(IntervalVec3& region) {
+	region.x = { std::max(region.x.lo, SCENE_BOUNDS_MIN.x), std::min(region.x.hi, SCENE_BOUNDS_MAX.x) };
+	region.y = { std::max(region.y.lo, SCENE_BOUNDS_MIN.y), std::min(region.y.hi, SCENE_BOUNDS_MAX.y) };
+	region.z = { std::max(region.z.lo, SCENE_BOUNDS_MIN.z), std::min(region.z.hi, SCENE_BOUNDS_MAX.z) };
+	return region.x.lo <= region.x.hi && region.y.lo <= region.y.hi && region.z.lo <= region.z.hi;
+}
+
+// Same ray direction as simple.frag generates for a position inside a view's tile, not normalized
+static glm::vec3 rayDirection(const ViewTransform& view, float x, float y, float viewWidth, float viewHeight) {
+	glm::vec2 fragPos = glm::vec2(x / viewWidth, y / viewHeight) * 2.0f - 1.0f;
+	fragPos.x *= viewWidth / viewHeight;
+	return glm::vec3(view.cameraToWorld * glm::vec4(fragPos.x, fragPos.y, FOV, 0.0f));
+}
+
+void pruneTiles(const ViewTransform* views, unsigned int numViews, int imageWidth, int imageHeight, int tileSize,
+				int regionX, int regionY, int regionWidth, int regionHeight, std::vector<unsigned char>& tileParts) {
+	int tilesX = (imageWidth + tileSize - 1) / tileSize;
+	int tilesY = (imageHeight + tileSize - 1) / tileSize;
+	tileParts.assign(size_t(tilesX) * tilesY, 0);
+
+	int regionFirstTileX = std::max(regionX / tileSize, 0);
+	int regionLastTileX = std::min((regionX + regionWidth - 1) / tileSize, tilesX - 1);
+	int regionFirstTileY = std::max(regionY / tileSize, 0);
+	int regionLastTileY = std::min((regionY + regionHeight - 1) / tileSize, tilesY - 1);
+
+	float viewWidth = float(imageWidth) / float(numViews);
+	float viewHeight = float(imageHeight);
+
+	for (unsigned int view = 0; view < numViews; view++) {
+		glm::vec3 position = glm::vec3(views[view].position);
+
+		// Every point of the scene is within the distance to the farthest corner of the bounds. Ray directions are
+		// at least FOV long, so stepping that distance / FOV along any of them leaves the scene behind
+		float farthest = 0.0f;
+		for (int corner = 0; corner < 8; corner++) {
+			glm::vec3 cornerPoint((corner & 1) ? SCENE_BOUNDS_MAX.x : SCENE_BOUNDS_MIN.x,
+								  (corner & 2) ? SCENE_BOUNDS_MAX.y : SCENE_BOUNDS_MIN.y,
+								  (corner & 4) ? SCENE_BOUNDS_MAX.z : SCENE_BOUNDS_MIN.z);
+			farthest = std::max(farthest, glm::length(cornerPoint - position));
+		}
+		float maxParameter = farthest / FOV;
+
+		float viewStart = view * viewWidth;
+		float viewEnd = viewStart + viewWidth;
+		int firstTileX = std::max(int(viewStart) / tileSize, regionFirstTileX);
+		int lastTileX = std::min(int(std::ceil(viewEnd)) / tileSize, regionLastTileX);
+
+		for (int tileX = firstTileX; tileX <= lastTileX; tileX++) {
+			// Tile edges in view coordinates, clipped to the view for tiles on a view border
+			float x0 = std::max(float(tileX * tileSize), viewStart) - viewStart;
+			float x1 = std::min(float((tileX + 1) * tileSize), viewEnd) - viewStart;
+			if (x1 <= x0) {
+				continue;
+			}
+
+			for (int tileY = regionFirstTileY; tileY <= regionLastTileY; tileY++) {
+				float y0 = float(tileY * tileSize);
+				float y1 = float(std::min((tileY + 1) * tileSize, imageHeight));
+				glm::vec3 corners[4] = {
+					rayDirection(views[view], x0, y0, viewWidth, viewHeight),
+					rayDirection(views[view], x1, y0, viewWidth, viewHeight),
+					rayDirection(views[view], x0, y1, viewWidth, viewHeight),
+					rayDirection(views[view], x1, y1, viewWidth, viewHeight)
+				};
+
+				// The frustum segment of a slice lies inside the box around its eight corners
+				unsigned int parts = 0;
+				for (int slice = 0; slice < FRUSTUM_SLICES; slice++) {
+					float sliceStart = maxParameter * slice / FRUSTUM_SLICES;
+					float sliceEnd = maxParameter * (slice + 1) / FRUSTUM_SLICES;
+
+					IntervalVec3 region = { { INFINITY, -INFINITY }, { INFINITY, -INFINITY }, { INFINITY, -INFINITY } };
+					for (const glm::vec3& direction : corners) {
+						includePoint(region, position + direction * sliceStart);
+						includePoint(region, position + direction * sliceEnd);
+					}
+					if (clipToSceneBounds(region)) {
+						parts |= visibleSceneParts(region);
+					}
+				}
+
+				// Tiles on a view border keep the parts either view needs
+				tileParts[size_t(tileY) * tilesX + tileX] |= parts;
+			}
+		}
+	}
+
+	// Rays of tiles that never enter the scene bounds do not use the mask, but keep it safe. Tiles outside the region
+	// were not evaluated and keep every part as well
+	for (unsigned char& parts : tileParts) {
+		if (parts == 0) {
+			parts = ALL_PARTS;
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "gamelogic.h"
+#include "sdfInterval.hpp"
+
+#include <vector>
+
+// Parts of mapWorld in simple.frag, as bits of a tile mask. Must match PART_* in simple.frag
+enum ScenePart {
+	PART_GROUND = 1,
+	PART_COLUMNS = 2,
+	PART_COLUMN_GAP = 4,		// The box removing one row of columns
+	PART_FLOOR = 8,
+	PART_FLOOR_GAP = 16,		// The box removing one row of floor tiles
+	PART_ROOF = 32
+};
+const unsigned int ALL_PARTS = 63;
+
+// Parts of the scene that can change the distance anywhere inside a box of points. Every other part is provably
+// farther away than one of the kept ones (unions) or provably does not cut into them (differences)
+unsigned int visibleSceneParts(const IntervalVec3& region);
+
+// Finds the parts every screen tile needs, by evaluating the scene with interval arithmetic over the part of each
+// tile's ray frustum that lies inside the scene bounds. Masks are stored row by row, bottom row first.
+// Only tiles overlapping the region (in pixels) are evaluated, the masks of the other tiles keep every part
+void pruneTiles(const ViewTransform* views, unsigned int numViews, int imageWidth, int imageHeight, int tileSize,
+				int regionX, int regionY, int regionWidth, int regionHeight, std::vector<unsigned char>& tileParts);
@@ -38,6 +38,14 @@ namespace Gloom
         /* Getter for the view matrix */
         glm::mat4 getViewMatrix() { return matView; }
 
+		/* Place the camera at a fixed pose, given as yaw (around y) and pitch (around x) in radians */
+		void setPose(glm::vec3 position, GLfloat yaw, GLfloat pitch)
+		{
+			cPosition   = position;
+			cQuaternion = glm::quat(glm::vec3(0.0f, yaw, 0.0f)) * glm::quat(glm::vec3(pitch, 0.0f, 0.0f));
+			updateViewMatrix();
+		}
+
 
         /* Handle keyboard inputs from a callback mechanism */
         void handleKeyboardInputs(int key, int action)
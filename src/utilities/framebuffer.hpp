@@ -0,0 +1,85 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+#pragma once
+
+// System headers
+#include <glad/glad.h>
+#include <vector>
+
+// Standard headers
+#include <cstdio>
+
+
+namespace Gloom
+{
+    class Framebuffer
+    {
+    public:
+        Framebuffer()       { glGenFramebuffers(1, &mFramebuffer); }
+
+        // Public member functions
+        void   bind()       { glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer); }
+        void   unbind()     { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+        GLuint get()        { return mFramebuffer; }
+
+        /* Getter for the texture of a colour attachment */
+        GLuint getTexture(unsigned int attachment) { return mTextures[attachment]; }
+
+        /* Create a 2D texture and attach it as the next colour attachment */
+        GLuint addColorTexture(GLenum internalFormat, GLenum format, GLenum type,
+                               int width, int height, GLenum filter = GL_NEAREST)
+        {
+            GLuint texture;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+            bind();
+            GLenum attachment = GL_COLOR_ATTACHMENT0 + GLenum(mTextures.size());
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+            mTextures.push_back(texture);
+            mAttachments.push_back(attachment);
+            glDrawBuffers(GLsizei(mAttachments.size()), mAttachments.data());
+
+            return texture;
+        }
+
+        /* Check that the framebuffer can be rendered to */
+        bool isComplete()
+        {
+            bind();
+            GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+            if (status != GL_FRAMEBUFFER_COMPLETE)
+            {
+                fprintf(stderr, "Framebuffer is incomplete (0x%x).\n", status);
+                return false;
+            }
+            return true;
+        }
+
+        /* Delete the framebuffer and all attached textures */
+        void destroy()
+        {
+            glDeleteTextures(GLsizei(mTextures.size()), mTextures.data());
+            glDeleteFramebuffers(1, &mFramebuffer);
+            mTextures.clear();
+            mAttachments.clear();
+        }
+
+    private:
+        // Disable copying and assignment
+        Framebuffer(Framebuffer const &) = delete;
+        Framebuffer & operator =(Framebuffer const &) = delete;
+
+        // Private member variables
+        GLuint mFramebuffer;
+        std::vector<GLuint> mTextures;
+        std::vector<GLenum> mAttachments;
+    };
+}
+
+#endif
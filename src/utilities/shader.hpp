@@ -8,10 +8,16 @@
 
 // Standard headers
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <memory>
 #include <string>
 
+// Local headers
+#include "shaderSources.h"
+
 
 namespace Gloom
 {
@@ -42,6 +48,13 @@ namespace Gloom
             auto src = std::string(std::istreambuf_iterator<char>(fd),
                                   (std::istreambuf_iterator<char>()));
 
+            attachSource(filename, src);
+        }
+
+
+        /* Attach a shader given its source. The name decides the shader type by its extension */
+        void attachSource(std::string const &filename, std::string const &src)
+        {
             // Create shader object
             const char * source = src.c_str();
             auto shader = create(filename);
@@ -95,6 +108,57 @@ namespace Gloom
             link();
         }
 
+        /* Builds a program from embedded (or overridden) shader sources, see shaderSources.h.
+           Linked programs are cached in cacheDirectory with glGetProgramBinary, one file per program
+           named after its shaders. The file stores a hash of the sources and the driver, so a changed
+           shader replaces the entry. Invalid or stale cache entries fall back to compiling */
+        void makeCachedShader(std::vector<std::string> const shaders, std::string const &cacheDirectory)
+        {
+            std::vector<std::string> sources;
+            for (auto const &name : shaders)
+                sources.push_back(getShaderSource(name));
+
+            // Key the cache by every source and the driver that produced the binary
+            uint64_t hash = 14695981039346656037ull;
+            auto hashString = [&hash](std::string const &text)
+            {
+                for (unsigned char c : text) { hash ^= c; hash *= 1099511628211ull; }
+                hash ^= 0xff; hash *= 1099511628211ull;
+            };
+            for (size_t i = 0; i < shaders.size(); i++)
+            {
+                hashString(shaders[i]);
+                hashString(sources[i]);
+            }
+            hashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+            hashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+            hashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+            // e.g. simple.vert+simple.frag.bin
+            std::string cacheFile;
+            if (!cacheDirectory.empty())
+            {
+                cacheFile = cacheDirectory + "/";
+                for (size_t i = 0; i < shaders.size(); i++)
+                    cacheFile += (i ? "+" : "") + shaders[i];
+                cacheFile += ".bin";
+            }
+
+            if (!cacheFile.empty() && loadBinary(cacheFile, hash))
+                return;
+
+            // Compile from source, allowing the driver to hand out the linked binary
+            glDeleteProgram(mProgram);
+            mProgram = glCreateProgram();
+            glProgramParameteri(mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            for (size_t i = 0; i < shaders.size(); i++)
+                attachSource(shaders[i], sources[i]);
+            link();
+
+            if (!cacheFile.empty() && mStatus)
+                saveBinary(cacheFile, hash);
+        }
+
         /* Convenience function to get a uniforms ID from a string
            containing its name */
         GLint getUniformFromName(std::string const &uniformName) {
@@ -138,6 +202,66 @@ namespace Gloom
         }
 
     private:
+        /* Load a program binary written by saveBinary. Fails if it was built from other
+           sources or by another driver, or if the driver rejects it */
+        bool loadBinary(std::string const &filename, uint64_t hash)
+        {
+            std::ifstream fd(filename.c_str(), std::ios::binary);
+            if (fd.fail())
+                return false;
+
+            uint64_t storedHash = 0;
+            fd.read(reinterpret_cast<char*>(&storedHash), sizeof(storedHash));
+            if (fd.fail() || storedHash != hash)
+                return false;
+
+            GLenum format;
+            fd.read(reinterpret_cast<char*>(&format), sizeof(format));
+            std::string binary((std::istreambuf_iterator<char>(fd)),
+                               (std::istreambuf_iterator<char>()));
+            if (fd.bad() || binary.empty())
+                return false;
+
+            glProgramBinary(mProgram, format, binary.data(), GLsizei(binary.size()));
+            glGetProgramiv(mProgram, GL_LINK_STATUS, &mStatus);
+            return mStatus == GL_TRUE;
+        }
+
+        /* Store the linked program binary. Written to a temporary file first so
+           concurrent processes never read a partial entry */
+        void saveBinary(std::string const &filename, uint64_t hash)
+        {
+            glGetProgramiv(mProgram, GL_PROGRAM_BINARY_LENGTH, &mLength);
+            if (mLength <= 0)
+                return;
+
+            std::unique_ptr<char[]> binary(new char[mLength]);
+            GLenum format;
+            glGetProgramBinary(mProgram, mLength, nullptr, &format, binary.get());
+
+            std::string temporary = filename + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+            {
+                std::ofstream fd(temporary.c_str(), std::ios::binary);
+                fd.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+                fd.write(reinterpret_cast<const char*>(&format), sizeof(format));
+                fd.write(binary.get(), mLength);
+                if (fd.fail())
+                {
+                    fd.close();
+                    std::remove(temporary.c_str());
+                    return;
+                }
+            }
+
+#ifdef _WIN32
+            // rename does not replace an existing file on Windows. A process
+            // loading in between misses the cache and links from source
+            std::remove(filename.c_str());
+#endif
+            if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+                std::remove(temporary.c_str());
+        }
+
         // Disable copying and assignment
         Shader(Shader const &) = delete;
         Shader & operator =(Shader const &) = delete;
@@ -0,0 +1,70 @@
+#include "shaderSources.h"
+#include <embeddedShaders.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static std::string _overrideDirectory;
+
+void setShaderOverrideDirectory(std::string const &directory) {
+	_overrideDirectory = directory;
+}
+
+std::string getShaderSource(std::string const &name) {
+	// Files in the override directory take precedence, so shaders can be edited without rebuilding
+	if (!_overrideDirectory.empty()) {
+		std::ifstream fd((_overrideDirectory + "/" + name).c_str());
+		if (!fd.fail()) {
+			return std::string(std::istreambuf_iterator<char>(fd), (std::istreambuf_iterator<char>()));
+		}
+	}
+
+	for (const EmbeddedShader* shader = embeddedShaders; shader->name != nullptr; shader++) {
+		if (name == shader->name) {
+			return std::string(shader->source, shader->size);
+		}
+	}
+
+	fprintf(stderr, "Unknown shader \"%s\".\n", name.c_str());
+	return "";
+}
+
+static void makeDirectory(std::string const &path) {
+#ifdef _WIN32
+	_mkdir(path.c_str());
+#else
+	mkdir(path.c_str(), 0755);
+#endif
+}
+
+std::string getShaderCacheDirectory() {
+	// Follow the platform conventions for per-user cache files
+#ifdef _WIN32
+	const char* base = std::getenv("LOCALAPPDATA");
+	if (base == nullptr) {
+		return "";
+	}
+	std::string cacheRoot = base;
+#else
+	std::string cacheRoot;
+	if (const char* xdgCache = std::getenv("XDG_CACHE_HOME")) {
+		cacheRoot = xdgCache;
+	} else if (const char* home = std::getenv("HOME")) {
+		cacheRoot = std::string(home) + "/.cache";
+	} else {
+		return "";
+	}
+#endif
+	makeDirectory(cacheRoot);
+
+	std::string directory = cacheRoot + "/raymarching";
+	makeDirectory(directory);
+	return directory;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+// Shader sources are embedded in the executable at build time. For development, an override directory
+// can be set; shader files found there are used instead of the embedded copies.
+void setShaderOverrideDirectory(std::string const &directory);
+
+// Returns the source of a shader by file name (e.g. "simple.frag"), or an empty string if it does not exist
+std::string getShaderSource(std::string const &name);
+
+// Directory for cached program binaries. Created if missing. Empty if no suitable location was found
+std::string getShaderCacheDirectory();
@@ -16,4 +16,7 @@ const int         windowSamples   = 4;
 struct CommandLineOptions {
     bool enableMusic;
     bool enableAutoplay;
+    bool renderOnDemand;
+    bool checkerboard;
+    bool animateLight;
 };
\ No newline at end of file
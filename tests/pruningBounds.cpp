@@ -0,0 +1,212 @@
+// Checks the interval arithmetic mirror of mapWorld in src/pruning against a point-wise mirror of the shader.
+//
+// For random boxes of points it checks that
+// - every interval SDF operation contains the values of the point-wise operation inside the box, and
+// - the parts visibleSceneParts keeps give the same distance as the whole scene at every sampled point.
+//
+// The point-wise functions below are line by line copies of simple.frag. When changing mapWorld, update them
+// together with tilePruning.cpp.
+
+#include "pruning/tilePruning.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+const int BOX_COUNT = 50000;
+const int SAMPLES_PER_BOX = 16;
+
+// Pruning drops parts that lose by more than PRUNE_EPSILON in tilePruning.cpp, float rounding stays well below
+const float DISTANCE_TOLERANCE = 1e-5f;
+const float PI = 3.14159265f;
+
+/*======================================================================================*/
+// Point-wise mirror of simple.frag
+
+static float roundGLSL(float value) {
+	return std::round(value);
+}
+
+static glm::vec3 opRepeatLim(glm::vec3 point, float period, glm::vec3 length) {
+	return glm::vec3(point.x - period * glm::clamp(roundGLSL(point.x / period), -length.x, length.x),
+					 point.y - period * glm::clamp(roundGLSL(point.y / period), -length.y, length.y),
+					 point.z - period * glm::clamp(roundGLSL(point.z / period), -length.z, length.z));
+}
+
+static float opDifference(float distA, float distB) {
+	return std::max(distA, -distB);
+}
+
+static float sMin(float distA, float distB, float k) {
+	float h = std::max(k - std::abs(distA - distB), 0.0f) / k;
+	return std::min(distA, distB) - h * h * h * k * (1.0f / 6.0f);
+}
+
+static float boxSDF(glm::vec3 p, glm::vec3 size) {
+	glm::vec3 d = glm::abs(p) - size;
+	return std::min(std::max(d.x, std::max(d.y, d.z)), 0.0f) + glm::length(glm::max(d, glm::vec3(0.0f)));
+}
+
+static float cylinderSDF(glm::vec3 p, float radius, float len) {
+	glm::vec2 d = glm::abs(glm::vec2(glm::length(glm::vec2(p.x, p.z)), p.y)) - glm::vec2(len, radius);
+	return std::min(std::max(d.x, d.y), 0.0f) + glm::length(glm::max(d, glm::vec2(0.0f)));
+}
+
+static float torusSDF(glm::vec3 point, glm::vec2 thickness) {
+	glm::vec2 q = glm::vec2(glm::length(glm::vec2(point.x, point.z)) - thickness.x, point.y);
+	return glm::length(q) - thickness.y;
+}
+
+static float columnDetailSDF(glm::vec3 columnPoint) {
+	float angle = 2.0f * PI / 24.0f;
+	float sector = roundGLSL(std::atan2(columnPoint.z, columnPoint.x) / angle);
+	float c = std::cos(sector * angle);
+	float s = std::sin(sector * angle);
+	glm::vec3 rotatedPoint = columnPoint;
+	rotatedPoint.x = c * columnPoint.x + s * columnPoint.z;
+	rotatedPoint.z = -s * columnPoint.x + c * columnPoint.z;
+
+	float column = opDifference(cylinderSDF(columnPoint, 2.0f, 0.3f), cylinderSDF(rotatedPoint - glm::vec3(0.3f, 0.0f, 0.0f), 2.0f, 0.02f));
+	float top = opDifference(cylinderSDF(columnPoint - glm::vec3(0.0f, 2.0f, 0.0f), 0.05f, 0.45f) - 0.02f,
+							 torusSDF(columnPoint - glm::vec3(0.0f, 1.80f, 0.0f), glm::vec2(0.63f, 0.29f)));
+	return sMin(column, top, 0.5f);
+}
+
+static float columnBoundSDF(glm::vec3 columnPoint) {
+	return std::min(cylinderSDF(columnPoint, 2.0f, 0.3f), cylinderSDF(columnPoint - glm::vec3(0.0f, 2.0f, 0.0f), 0.05f, 0.45f) - 0.02f);
+}
+
+// mapScene with the column level of detail fade given directly instead of derived from the pixel footprint
+static float mapScene(glm::vec3 point, unsigned int parts, float detailFade) {
+	float res = 3.402823466e+38f;
+
+	if (parts & PART_GROUND) {
+		res = std::min(res, boxSDF(point - glm::vec3(0.0f, -7.0f, 0.0f), glm::vec3(25.0f, 1.0f, 25.0f)));
+	}
+
+	if (parts & PART_COLUMNS) {
+		glm::vec3 columnPoint = opRepeatLim(point, 4.35f, glm::vec3(2.0f, 0.0f, 1.0f));
+		columnPoint.y = std::abs(columnPoint.y) + 0.2f;
+
+		float column;
+		if (detailFade <= 0.0f) {
+			column = columnDetailSDF(columnPoint);
+		} else if (detailFade >= 1.0f) {
+			column = columnBoundSDF(columnPoint);
+		} else {
+			column = glm::mix(columnDetailSDF(columnPoint), columnBoundSDF(columnPoint), detailFade);
+		}
+		column = std::min(column, boxSDF(columnPoint - glm::vec3(0.0f, 2.14f, 0.0f), glm::vec3(0.5f, 0.08f, 0.5f)) - 0.02f);
+
+		if (parts & PART_COLUMN_GAP) {
+			column = opDifference(column, boxSDF(point - glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(10.0f, 2.5f, 2.0f)));
+		}
+		res = std::min(res, column);
+	}
+
+	if (parts & PART_FLOOR) {
+		glm::vec3 floorPoint = opRepeatLim(point - glm::vec3(0.0f, -2.0f, -2.90f), 1.45f, glm::vec3(7.0f, 0.0f, 3.0f));
+		float floor = boxSDF(floorPoint, glm::vec3(0.7f, 0.05f, 0.7f)) - 0.03f;
+		if (parts & PART_FLOOR_GAP) {
+			floor = opDifference(floor, boxSDF(point - glm::vec3(0.0f, -2.0f, -7.27f), glm::vec3(11.0f, 0.5f, 0.75f)));
+		}
+		res = std::min(res, floor);
+	}
+
+	if (parts & PART_ROOF) {
+		res = std::min(res, boxSDF(point - glm::vec3(0.0f, 2.1f, -2.2f), glm::vec3(9.6f, 0.1f, 3.0f)) - 0.03f);
+	}
+
+	return res;
+}
+
+/*======================================================================================*/
+// The primitives of mapScene, as intervals over a box and as values at a point
+
+const int PRIMITIVE_COUNT = 8;
+
+static void primitiveBounds(const IntervalVec3& region, Interval bounds[PRIMITIVE_COUNT]) {
+	IntervalVec3 columnRegion = opRepeatLim(region, 4.35f, glm::vec3(2.0f, 0.0f, 1.0f));
+	columnRegion.y = abs(columnRegion.y) + 0.2f;
+	IntervalVec3 floorRegion = opRepeatLim(region - glm::vec3(0.0f, -2.0f, -2.90f), 1.45f, glm::vec3(7.0f, 0.0f, 3.0f));
+
+	bounds[0] = boxSDF(region - glm::vec3(0.0f, -7.0f, 0.0f), glm::vec3(25.0f, 1.0f, 25.0f));
+	bounds[1] = cylinderSDF(columnRegion, 2.0f, 0.3f);
+	bounds[2] = cylinderSDF(columnRegion - glm::vec3(0.0f, 2.0f, 0.0f), 0.05f, 0.45f) - 0.02f;
+	bounds[3] = boxSDF(columnRegion - glm::vec3(0.0f, 2.14f, 0.0f), glm::vec3(0.5f, 0.08f, 0.5f)) - 0.02f;
+	bounds[4] = boxSDF(region - glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(10.0f, 2.5f, 2.0f));
+	bounds[5] = boxSDF(floorRegion, glm::vec3(0.7f, 0.05f, 0.7f)) - 0.03f;
+	bounds[6] = boxSDF(region - glm::vec3(0.0f, -2.0f, -7.27f), glm::vec3(11.0f, 0.5f, 0.75f));
+	bounds[7] = boxSDF(region - glm::vec3(0.0f, 2.1f, -2.2f), glm::vec3(9.6f, 0.1f, 3.0f)) - 0.03f;
+}
+
+static void primitiveValues(glm::vec3 point, float values[PRIMITIVE_COUNT]) {
+	glm::vec3 columnPoint = opRepeatLim(point, 4.35f, glm::vec3(2.0f, 0.0f, 1.0f));
+	columnPoint.y = std::abs(columnPoint.y) + 0.2f;
+	glm::vec3 floorPoint = opRepeatLim(point - glm::vec3(0.0f, -2.0f, -2.90f), 1.45f, glm::vec3(7.0f, 0.0f, 3.0f));
+
+	values[0] = boxSDF(point - glm::vec3(0.0f, -7.0f, 0.0f), glm::vec3(25.0f, 1.0f, 25.0f));
+	values[1] = cylinderSDF(columnPoint, 2.0f, 0.3f);
+	values[2] = cylinderSDF(columnPoint - glm::vec3(0.0f, 2.0f, 0.0f), 0.05f, 0.45f) - 0.02f;
+	values[3] = boxSDF(columnPoint - glm::vec3(0.0f, 2.14f, 0.0f), glm::vec3(0.5f, 0.08f, 0.5f)) - 0.02f;
+	values[4] = boxSDF(point - glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(10.0f, 2.5f, 2.0f));
+	values[5] = boxSDF(floorPoint, glm::vec3(0.7f, 0.05f, 0.7f)) - 0.03f;
+	values[6] = boxSDF(point - glm::vec3(0.0f, -2.0f, -7.27f), glm::vec3(11.0f, 0.5f, 0.75f));
+	values[7] = boxSDF(point - glm::vec3(0.0f, 2.1f, -2.2f), glm::vec3(9.6f, 0.1f, 3.0f)) - 0.03f;
+}
+
+static bool contains(Interval interval, float value) {
+	return value >= interval.lo - DISTANCE_TOLERANCE && value <= interval.hi + DISTANCE_TOLERANCE;
+}
+
+int main() {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+	long samples = 0;
+	long boundFailures = 0;
+	long pruneFailures = 0;
+
+	for (int box = 0; box < BOX_COUNT; box++) {
+		// Half of the boxes anywhere in the scene bounds, half around the temple. Sizes from a centimetre to 3 metres
+		glm::vec3 corner = (box % 2)
+			? glm::vec3(-12.0f + 24.0f * uniform(random), -4.0f + 7.0f * uniform(random), -10.0f + 14.0f * uniform(random))
+			: glm::vec3(-25.0f + 50.0f * uniform(random), -8.0f + 10.5f * uniform(random), -25.0f + 50.0f * uniform(random));
+		float size = std::pow(10.0f, -2.0f + 2.5f * uniform(random));
+		glm::vec3 extent(size * uniform(random), size * uniform(random), size * uniform(random));
+		IntervalVec3 region = { { corner.x, corner.x + extent.x }, { corner.y, corner.y + extent.y }, { corner.z, corner.z + extent.z } };
+
+		unsigned int parts = visibleSceneParts(region);
+		Interval bounds[PRIMITIVE_COUNT];
+		primitiveBounds(region, bounds);
+
+		for (int sample = 0; sample < SAMPLES_PER_BOX; sample++) {
+			glm::vec3 point = corner + extent * glm::vec3(uniform(random), uniform(random), uniform(random));
+			samples++;
+
+			// Interval operations contain the point-wise values
+			float values[PRIMITIVE_COUNT];
+			primitiveValues(point, values);
+			for (int primitive = 0; primitive < PRIMITIVE_COUNT; primitive++) {
+				if (!contains(bounds[primitive], values[primitive]) && boundFailures++ < 5) {
+					fprintf(stderr, "Bound [%g, %g] of primitive %i misses %g at (%g, %g, %g)\n", bounds[primitive].lo, bounds[primitive].hi,
+						primitive, values[primitive], point.x, point.y, point.z);
+				}
+			}
+
+			// Pruned parts never change the distance, at every level of detail
+			float detailFade = 0.5f * float(sample % 3);
+			float full = mapScene(point, ALL_PARTS, detailFade);
+			float pruned = mapScene(point, parts, detailFade);
+			if (std::abs(full - pruned) > DISTANCE_TOLERANCE) {
+				if (pruneFailures++ < 5) {
+					fprintf(stderr, "Mask %u changes the distance at (%g, %g, %g): %g instead of %g\n", parts, point.x, point.y, point.z, pruned, full);
+				}
+			}
+		}
+	}
+
+	printf("%ld samples, %ld outside their interval bounds, %ld changed by pruning\n", samples, boundFailures, pruneFailures);
+	return (boundFailures == 0 && pruneFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}